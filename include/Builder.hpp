@@ -1,14 +1,21 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <cassert>
+#include <cstdint>
 #include <functional>
 #include <iostream>
 #include <iterator>
 #include <numeric>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "LevelIndex.hpp"
+#include "Permutation.hpp"
 #include "tuple_algorithms.hpp"
 #include "type_traits.hpp"
 
@@ -17,26 +24,165 @@ namespace ParameterSweep {
 enum class Order
 {
   Default,
-  Sorted
+  Sorted,
+  Gray
 };
 std::ostream& operator<<(std::ostream&, Order const&);
 
 enum class Design
 {
   FullFactorial,
-  OneAtATime
+  OneAtATime,
+  LatinHypercube
 };
 std::ostream& operator<<(std::ostream&, Design const&);
 
+enum class Sharding
+{
+  Blocked,
+  Interleaved,
+  ReplicantBlocked
+};
+std::ostream& operator<<(std::ostream&, Sharding const&);
+
+/*
+ * A view of every stride-th point of a sweep starting at first
+ */
+template <class Iterator>
+class Shard
+{
+public:
+  using base_difference_type =
+    typename std::iterator_traits<Iterator>::difference_type;
+
+  Shard(Iterator first, size_t count, size_t stride = 1)
+    : first(first)
+    , count(count)
+    , stride(stride)
+  {}
+
+  class iterator
+  {
+  public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename std::iterator_traits<Iterator>::value_type;
+    using reference = decltype(*std::declval<Iterator const&>());
+    using pointer = value_type const*;
+    using iterator_category = std::random_access_iterator_tag;
+
+    iterator()
+      : shard(nullptr)
+      , position(0)
+      , current()
+    {}
+    iterator(Shard const* shard, size_t position)
+      : shard(shard)
+      , position(position)
+      , current(shard->first)
+    {
+      if (position != 0 && position < shard->count) {
+        current += static_cast<base_difference_type>(position * shard->stride);
+      }
+    }
+
+    reference operator*() const { return *current; }
+    pointer operator->() const { return &*current; }
+    reference operator[](difference_type n) const { return *(*this + n); }
+
+    iterator& operator++() { return *this += 1; }
+    iterator operator++(int)
+    {
+      iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+    iterator& operator--() { return *this -= 1; }
+    iterator operator--(int)
+    {
+      iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+    iterator& operator+=(difference_type n)
+    {
+      auto target = static_cast<difference_type>(position) + n;
+      // only move the underlying iterator to positions inside the shard
+      if (target >= 0 && static_cast<size_t>(target) < shard->count) {
+        if (position < shard->count) {
+          current += static_cast<base_difference_type>(
+            n * static_cast<difference_type>(shard->stride));
+        } else {
+          current = shard->first + static_cast<base_difference_type>(
+                                     target * shard->stride);
+        }
+      }
+      position = target;
+      return *this;
+    }
+    iterator& operator-=(difference_type n) { return *this += (-n); }
+    iterator operator+(difference_type n) const
+    {
+      iterator tmp = *this;
+      tmp += n;
+      return tmp;
+    }
+    iterator operator-(difference_type n) const { return *this + (-n); }
+    difference_type operator-(iterator const& it) const
+    {
+      return static_cast<difference_type>(position) -
+             static_cast<difference_type>(it.position);
+    }
+
+    bool operator==(iterator const& it) const
+    {
+      return position == it.position;
+    }
+    bool operator!=(iterator const& it) const { return !(*this == it); }
+    bool operator<(iterator const& it) const { return position < it.position; }
+    bool operator>(iterator const& it) const { return it < *this; }
+    bool operator<=(iterator const& it) const { return !(it < *this); }
+    bool operator>=(iterator const& it) const { return !(*this < it); }
+
+    // the iterator into the full sweep
+    Iterator const& base() const { return current; }
+    auto get_id() const { return current.get_id(); }
+    auto get_parameters() const { return current.get_parameters(); }
+
+  private:
+    Shard const* shard;
+    size_t position;
+    Iterator current;
+  };
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, count); }
+  size_t size() const { return count; }
+
+private:
+  Iterator first;
+  size_t count;
+  size_t stride;
+};
+
 template <class... Factors>
 class Builder
 {
 public:
+  // the number of entries in get_parameters()
+  static constexpr size_t parameter_arity =
+    (parameter_arity_v<Factors> + ... + 0);
+  using parameters_type = std::array<size_t, parameter_arity>;
+
   Builder(Factors... factors)
     : order(Order::Default)
     , design(Design::FullFactorial)
     , replicants(1)
+    , samples(0)
+    , seed(0)
+    , change_costs()
     , factors(std::forward_as_tuple(factors...))
+    , level_indices(LevelIndex<Factors>(factors)...)
+    , plan(make_plan())
   {}
 
   class iterator
@@ -50,21 +196,32 @@ public:
     using pointer = value_type*;
     using iterator_category = std::random_access_iterator_tag;
     using index_type = std::array<size_t, std::tuple_size<value_type>::value>;
+    using change_type = std::bitset<std::tuple_size<value_type>::value>;
 
     iterator(Builder const* builder, bool end_flag)
       : builder(builder)
-      , end_flag(end_flag)
+      , end_flag(end_flag || builder->size() == 0)
       , replicant(0)
+      , point(0)
       , indices()
-      , value(builder->get_value_at_index(indices))
-    {}
+      , changes()
+      , value()
+    {
+      if (!this->end_flag) {
+        changes.set();
+        builder->from_point(point, indices);
+        value = builder->get_value_at_index(indices);
+      }
+    }
 
     // forward iterator
     iterator()
       : builder(nullptr)
       , end_flag(true)
       , replicant()
+      , point()
       , indices()
+      , changes()
       , value()
     {}
 
@@ -78,8 +235,10 @@ public:
       std::swap(builder, it.builder);
       std::swap(end_flag, it.end_flag);
       std::swap(replicant, it.replicant);
+      std::swap(point, it.point);
       std::swap(value, it.value);
       std::swap(indices, it.indices);
+      std::swap(changes, it.changes);
     }
     // equality comparable
     bool operator==(iterator const& it) const
@@ -87,7 +246,8 @@ public:
       // make all end pointers equal
       auto e1 = is_endptr();
       auto e2 = it.is_endptr();
-      return (e1 && e2) || (!e1 && !e2 && indices == it.indices);
+      return (e1 && e2) || (!e1 && !e2 && point == it.point &&
+                            replicant == it.replicant);
     }
 
     bool operator!=(iterator const& it) const { return !(*this == it); }
@@ -95,9 +255,8 @@ public:
     {
       auto const* cmp = get_real_builder_or_null(it);
       if (cmp != nullptr) {
-        auto lhs = cmp->to_difference_type(indices, replicant, end_flag);
-        auto rhs =
-          cmp->to_difference_type(it.indices, it.replicant, it.end_flag);
+        auto lhs = cmp->to_difference_type(point, replicant, end_flag);
+        auto rhs = cmp->to_difference_type(it.point, it.replicant, it.end_flag);
         return lhs < rhs;
       } else {
         // two end pointers are equal to each other not less than
@@ -126,10 +285,12 @@ public:
       replicant++;
       if (replicant >= builder->replicants) {
         replicant = 0;
-        builder->next_index(indices, end_flag);
+        changes = builder->next_index(point, indices, end_flag);
         if (!end_flag) {
-          value = builder->get_value_at_index(indices);
+          builder->update_value_at_index(indices, changes, value);
         }
+      } else {
+        changes.reset();
       }
       return *this;
     }
@@ -151,9 +312,8 @@ public:
     {
       auto const* cmp = get_real_builder_or_null(it);
       if (cmp != nullptr) {
-        auto lhs = cmp->to_difference_type(indices, replicant, end_flag);
-        auto rhs =
-          cmp->to_difference_type(it.indices, it.replicant, it.end_flag);
+        auto lhs = cmp->to_difference_type(point, replicant, end_flag);
+        auto rhs = cmp->to_difference_type(it.point, it.replicant, it.end_flag);
         return lhs - rhs;
       } else {
         // if both pointers have no builder, they are both end pointers and thus
@@ -170,10 +330,17 @@ public:
     }
     iterator& operator+=(difference_type n)
     {
-      auto pos = builder->to_difference_type(indices, replicant, end_flag);
-      builder->from_difference_type(pos + n, indices, replicant, end_flag);
+      auto pos = builder->to_difference_type(point, replicant, end_flag);
+      auto last_indices = indices;
+      auto was_end = end_flag;
+      builder->from_difference_type(pos + n, point, indices, replicant,
+                                    end_flag);
+      changes.reset();
       if (!end_flag) {
-        value = builder->get_value_at_index(indices);
+        for (size_t i = 0; i < indices.size(); ++i) {
+          changes[i] = was_end || last_indices[i] != indices[i];
+        }
+        builder->update_value_at_index(indices, changes, value);
       }
       return *this;
     }
@@ -201,46 +368,40 @@ public:
 
     difference_type get_id() const
     {
-      return builder->to_difference_type(indices, replicant, end_flag);
+      return builder->to_difference_type(point, replicant, end_flag);
     }
 
     index_type get_indices() const { return indices; }
 
+    // the factors whose level changed when the iterator last moved
+    change_type const& changed() const { return changes; }
+
     auto const& get_factors() const { return builder->get_factors(); }
 
     std::vector<size_t> get_parameters() const
     {
-      std::vector<size_t> parameters;
-      auto const& factors = builder->get_factors();
-      auto const& indices_tup = array_to_tuple(indices);
-
-      auto params_t = tuple_transform(
-        [](auto const& factor, auto const& index) -> std::vector<size_t> {
-          if constexpr (is_builder_v<std::decay_t<decltype(factor)>>) {
-            return factor.get_parameters(index);
-          } else {
-            return std::vector<size_t>{ index };
-          }
-        },
-        factors, indices_tup);
-
-      auto params_a = tuple_to_array<std::vector<size_t>>(params_t);
+      return builder->get_parameters_at_index(indices);
+    }
 
-      std::vector<size_t> params_v;
-      for (auto const& param : params_a) {
-        for (auto const& entry : param) {
-          params_v.push_back(entry);
-        }
-      }
+    parameters_type get_parameter_array() const
+    {
+      parameters_type parameters;
+      write_parameters(parameters.data());
+      return parameters;
+    }
 
-      return params_v;
+    size_t* write_parameters(size_t* out) const
+    {
+      return builder->write_parameters_at_index(indices, out);
     }
 
   private:
     Builder const* builder;
     bool end_flag;
     size_t replicant;
+    size_t point;
     index_type indices;
+    change_type changes;
     value_type value;
 
     bool is_endptr() const { return end_flag || builder == nullptr; }
@@ -266,58 +427,275 @@ public:
 
   using value_type = typename iterator::value_type;
 
-  iterator begin() const { return { this, false }; }
+  /*
+   * an iterator that only tracks the indices of the current point
+   *
+   * Values are looked up when the cursor is dereferenced.  Factors with
+   * stable storage, like std::vector, are returned by const reference, other
+   * factors by value.
+   */
+  class cursor
+  {
+  public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename iterator::value_type;
+    using reference = std::tuple<level_reference_t<Factors>...>;
+    using pointer = void;
+    using iterator_category = std::random_access_iterator_tag;
+    using index_type = typename iterator::index_type;
+    using change_type = typename iterator::change_type;
 
-  iterator end() const { return { this, true }; }
+    cursor()
+      : builder(nullptr)
+      , end_flag(true)
+      , replicant()
+      , point()
+      , indices()
+      , changes()
+    {}
+    cursor(Builder const* builder, bool end_flag)
+      : builder(builder)
+      , end_flag(end_flag || builder->size() == 0)
+      , replicant(0)
+      , point(0)
+      , indices()
+      , changes()
+    {
+      if (!this->end_flag) {
+        changes.set();
+        builder->from_point(point, indices);
+      }
+    }
 
-  auto levels() const
-  {
-    auto dim_tuple =
-      tuple_transform([](auto&& factor) { return std::size(factor); }, factors);
-    auto dim = tuple_to_array<size_t>(dim_tuple);
-    return dim;
-  }
+    reference operator*() const
+    {
+      return builder->get_reference_at_index(
+        indices, std::index_sequence_for<Factors...>{});
+    }
+    reference operator[](difference_type n) const { return *(*this + n); }
 
-  size_t size() const
-  {
-    auto sizes =
-      tuple_transform([](auto&& factor) { return std::size(factor); }, factors);
-    auto sizes_array = tuple_to_array<size_t>(sizes);
-    if (std::size(sizes_array) != 0) {
-      switch (design) {
-        case Design::FullFactorial:
-          return replicants * std::accumulate(std::begin(sizes_array),
-                                              std::end(sizes_array), 1,
-                                              std::multiplies<size_t>{});
-        case Design::OneAtATime:
-          return replicants * (std::accumulate(std::begin(sizes_array),
-                                               std::end(sizes_array), 0,
-                                               std::plus<size_t>{}) -
-                               (std::size(sizes_array) - 1));
-        default:
-          throw std::runtime_error{ "invalid design" };
+    // the value of factor I at the current point
+    template <size_t I>
+    decltype(auto) get() const
+    {
+      return builder->template get_level<I>(indices[I]);
+    }
+
+    cursor& operator++()
+    {
+      assert(builder != nullptr &&
+             "cannot increment a default constructed cursor");
+      replicant++;
+      if (replicant >= builder->replicants) {
+        replicant = 0;
+        changes = builder->next_index(point, indices, end_flag);
+      } else {
+        changes.reset();
       }
-    } else {
-      // if there are no factors, there is nothing to test
-      return 0;
+      return *this;
     }
-  }
+    cursor operator++(int)
+    {
+      cursor tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+    cursor& operator--() { return *this -= 1; }
+    cursor operator--(int)
+    {
+      cursor tmp = *this;
+      --(*this);
+      return tmp;
+    }
+    cursor& operator+=(difference_type n)
+    {
+      auto pos = builder->to_difference_type(point, replicant, end_flag);
+      auto last_indices = indices;
+      auto was_end = end_flag;
+      builder->from_difference_type(pos + n, point, indices, replicant,
+                                    end_flag);
+      changes.reset();
+      if (!end_flag) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+          changes[i] = was_end || last_indices[i] != indices[i];
+        }
+      }
+      return *this;
+    }
+    cursor& operator-=(difference_type n) { return *this += (-n); }
+    cursor operator+(difference_type n) const
+    {
+      cursor tmp = *this;
+      tmp += n;
+      return tmp;
+    }
+    cursor operator-(difference_type n) const { return *this + (-n); }
+    difference_type operator-(cursor const& it) const
+    {
+      return get_id_or_size(it) - it.get_id_or_size(*this);
+    }
+
+    bool operator==(cursor const& it) const
+    {
+      auto e1 = is_endptr();
+      auto e2 = it.is_endptr();
+      return (e1 && e2) || (!e1 && !e2 && point == it.point &&
+                            replicant == it.replicant);
+    }
+    bool operator!=(cursor const& it) const { return !(*this == it); }
+    bool operator<(cursor const& it) const
+    {
+      return get_id_or_size(it) < it.get_id_or_size(*this);
+    }
+    bool operator>(cursor const& it) const { return it < *this; }
+    bool operator<=(cursor const& it) const { return !(it < *this); }
+    bool operator>=(cursor const& it) const { return !(*this < it); }
+
+    difference_type get_id() const
+    {
+      return builder->to_difference_type(point, replicant, end_flag);
+    }
+    index_type const& get_indices() const { return indices; }
+    change_type const& changed() const { return changes; }
+    std::vector<size_t> get_parameters() const
+    {
+      return builder->get_parameters_at_index(indices);
+    }
+    parameters_type get_parameter_array() const
+    {
+      parameters_type parameters;
+      write_parameters(parameters.data());
+      return parameters;
+    }
+    size_t* write_parameters(size_t* out) const
+    {
+      return builder->write_parameters_at_index(indices, out);
+    }
+
+  private:
+    bool is_endptr() const { return end_flag || builder == nullptr; }
+    // a default constructed cursor is an end cursor of the other's builder
+    difference_type get_id_or_size(cursor const& other) const
+    {
+      Builder const* cmp = (builder == nullptr) ? other.builder : builder;
+      return (cmp == nullptr)
+               ? 0
+               : cmp->to_difference_type(point, replicant, is_endptr());
+    }
+
+    Builder const* builder;
+    bool end_flag;
+    size_t replicant;
+    size_t point;
+    index_type indices;
+    change_type changes;
+  };
 
+  struct cursor_range
+  {
+    cursor first;
+    cursor last;
+    cursor begin() const { return first; }
+    cursor end() const { return last; }
+    size_t size() const { return last - first; }
+  };
+
+  iterator begin() const { return { this, false }; }
+
+  iterator end() const { return { this, true }; }
+
+  cursor_range cursors() const { return { { this, false }, { this, true } }; }
+
+  auto levels() const { return plan.dims; }
+
+  size_t size() const { return plan.size; }
+
+  /*
+   * Default varies factor 0 fastest and visits levels in the order of each
+   * factor.  Sorted visits points in lexicographic order of their values: each
+   * factor's levels are sorted once and the last factor varies fastest.  Gray
+   * visits a full factorial design in reflected mixed-radix Gray code order,
+   * so exactly one factor changes between consecutive points.
+   */
   Builder& set_order(Order const& order)
   {
+    // nothing changes unless every factor could be sorted
+    sorted_type levels, ranks;
+    sort_levels(order, levels, ranks, std::index_sequence_for<Factors...>{});
+    auto new_plan = make_plan(order);
     this->order = order;
+    sorted_levels = std::move(levels);
+    sorted_ranks = std::move(ranks);
+    plan = std::move(new_plan);
+    return *this;
+  }
+
+  /*
+   * the relative cost of changing the level of each factor; in the default
+   * order the cheapest factors vary fastest and the most expensive slowest,
+   * with ties broken by declaration order.  Values and parameters are still
+   * reported in declaration order.  Order::Sorted ignores the costs;
+   * Order::Gray follows them.
+   */
+  Builder& set_factor_change_cost(
+    std::array<double, sizeof...(Factors)> const& costs)
+  {
+    change_costs = costs;
+    plan = make_plan();
     return *this;
   }
 
   Builder& set_design(Design const& design)
   {
     this->design = design;
+    plan = make_plan();
     return *this;
   }
 
   Builder& set_replicants(size_t replicants)
   {
     this->replicants = replicants;
+    plan = make_plan();
+    return *this;
+  }
+
+  /*
+   * the number of points drawn by Design::LatinHypercube; 0 draws as many
+   * points as the factor with the most levels has levels
+   */
+  Builder& set_samples(size_t samples)
+  {
+    this->samples = samples;
+    plan = make_plan();
+    return *this;
+  }
+
+  // the seed of the permutations used by Design::LatinHypercube
+  Builder& set_seed(std::uint64_t seed)
+  {
+    this->seed = seed;
+    plan = make_plan();
+    return *this;
+  }
+
+  /*
+   * factors whose iterators are not random access, like std::set, are
+   * copied into a random access index when the builder is constructed so
+   * that looking up a level does not walk the factor; passing false
+   * releases the copies and walks the factors instead
+   */
+  Builder& set_level_index(bool enabled)
+  {
+    if (enabled) {
+      level_indices = std::apply(
+        [](auto const&... factor) {
+          return std::make_tuple(
+            LevelIndex<std::decay_t<decltype(factor)>>(factor)...);
+        },
+        factors);
+    } else {
+      std::apply([](auto&... index) { (index.clear(), ...); }, level_indices);
+    }
     return *this;
   }
 
@@ -331,117 +709,607 @@ public:
 
   auto const& get_factors() const { return factors; }
 
-  auto get_parameters(size_t index) const
+  std::vector<size_t> get_parameters(size_t index) const
+  {
+    std::vector<size_t> parameters(parameter_arity);
+    write_parameters(index, parameters.data());
+    return parameters;
+  }
+
+  /*
+   * the parameters of the ids in [first, last) as a row-major matrix with
+   * parameter_arity columns
+   */
+  std::vector<size_t> get_parameters(size_t first, size_t last) const
+  {
+    last = std::min(last, plan.size);
+    if (first >= last) {
+      return {};
+    }
+    std::vector<size_t> parameters((last - first) * parameter_arity);
+    auto out = parameters.data();
+    size_t point, replicant;
+    bool end_flag;
+    typename iterator::index_type indices;
+    from_difference_type(first, point, indices, replicant, end_flag);
+    for (size_t id = first; id < last; ++id) {
+      out = write_parameters_at_index(indices, out);
+      if (++replicant >= replicants) {
+        replicant = 0;
+        next_index(point, indices, end_flag);
+      }
+    }
+    return parameters;
+  }
+
+  /*
+   * writes the parameter_arity parameters of the point at index to out,
+   * returning the end of what was written; values are never constructed
+   */
+  size_t* write_parameters(size_t index, size_t* out) const
   {
-    return std::next(begin(), index).get_parameters();
+    size_t point, replicant;
+    bool end_flag;
+    typename iterator::index_type indices;
+    from_difference_type(index, point, indices, replicant, end_flag);
+    return write_parameters_at_index(indices, out);
+  }
+
+  /*
+   * writes the parameters of each id in [first, last) to consecutive rows of
+   * out, returning the end of what was written
+   */
+  template <class InputIterator>
+  size_t* write_parameters(InputIterator first, InputIterator last,
+                           size_t* out) const
+  {
+    for (; first != last; ++first) {
+      out = write_parameters(static_cast<size_t>(*first), out);
+    }
+    return out;
+  }
+
+  /*
+   * writes the values of count points starting at id start into one output
+   * iterator per factor, returning the number of points written
+   *
+   * In a full factorial design the value of each factor only changes every
+   * stride ids, so each column is written as runs of repeated values or, for
+   * the fastest varying factor, as copies of the factor's levels.
+   */
+  template <class... OutputIterators>
+  size_t materialize(size_t start, size_t count,
+                     OutputIterators... columns) const
+  {
+    static_assert(sizeof...(OutputIterators) == sizeof...(Factors),
+                  "materialize requires one output iterator per factor");
+    if (start >= plan.size) {
+      return 0;
+    }
+    count = std::min(count, plan.size - start);
+    materialize_impl(start, count, std::make_tuple(columns...),
+                     std::index_sequence_for<Factors...>{});
+    return count;
+  }
+
+  /*
+   * the share of the sweep that rank of nranks should run
+   *
+   * Blocked gives each rank a contiguous range of ids, Interleaved gives each
+   * rank every nranks-th id, and ReplicantBlocked gives each rank a
+   * contiguous range of points with all of their replicants.
+   */
+  Shard<iterator> shard(size_t rank, size_t nranks,
+                        Sharding policy = Sharding::Blocked) const
+  {
+    assert(rank < nranks && "the rank must be less than the number of ranks");
+    switch (policy) {
+      case Sharding::Blocked: {
+        auto first = plan.size * rank / nranks;
+        auto last = plan.size * (rank + 1) / nranks;
+        return { begin() + first, last - first };
+      }
+      case Sharding::Interleaved: {
+        auto count =
+          (rank < plan.size) ? (plan.size - rank + nranks - 1) / nranks : 0;
+        return { begin() + rank, count, nranks };
+      }
+      case Sharding::ReplicantBlocked: {
+        auto first = plan.points * rank / nranks;
+        auto last = plan.points * (rank + 1) / nranks;
+        return { begin() + first * replicants, (last - first) * replicants };
+      }
+      default:
+        throw std::runtime_error{ "invalid sharding policy" };
+    }
   }
 
 private:
+  /*
+   * everything needed to map between ids and indices; factors are immutable
+   * once constructed, so this only needs to be rebuilt by set_design,
+   * set_replicants, set_order, set_factor_change_cost, set_samples, and
+   * set_seed
+   */
+  struct sweep_plan
+  {
+    // number of levels of each factor
+    typename iterator::index_type dims;
+    // the factors from the fastest varying to the slowest
+    typename iterator::index_type nesting;
+    // distance between points when the rank of each factor changes by one
+    typename iterator::index_type strides;
+    // for OneAtATime, the first point where the factor at each position of
+    // nesting is not at rank 0
+    typename iterator::index_type offsets;
+    // for LatinHypercube, the permutation pairing the strata of each factor
+    std::vector<FeistelPermutation> permutations;
+    // number of unique points visited by the design
+    size_t points;
+    // number of points including replicants
+    size_t size;
+  };
+
   Order order;
   Design design;
   size_t replicants;
+  size_t samples;
+  std::uint64_t seed;
+  std::array<double, sizeof...(Factors)> change_costs;
   std::tuple<Factors...> factors;
+  std::tuple<LevelIndex<Factors>...> level_indices;
+  // for Order::Sorted, the level of each factor at each rank and the inverse;
+  // empty when the levels are visited in the order of the factor
+  using sorted_type = std::array<std::vector<size_t>, sizeof...(Factors)>;
+  sorted_type sorted_levels;
+  sorted_type sorted_ranks;
+  sweep_plan plan;
 
-  typename iterator::difference_type to_difference_type(
-    typename iterator::index_type const& index, size_t const& replicant,
-    bool const end_flag) const
+  size_t level_at(size_t factor, size_t rank) const
   {
-    typename iterator::difference_type idx = 0;
-    typename iterator::index_type boundries;
+    auto const& levels = sorted_levels[factor];
+    return levels.empty() ? rank : levels[rank];
+  }
 
-    auto dim = levels();
+  size_t rank_of(size_t factor, size_t level) const
+  {
+    auto const& ranks = sorted_ranks[factor];
+    return ranks.empty() ? level : ranks[level];
+  }
+
+  template <size_t... Is>
+  void sort_levels(Order const& sort_order, sorted_type& levels,
+                   sorted_type& ranks, std::index_sequence<Is...>) const
+  {
+    (sort_factor_levels<Is>(sort_order, levels[Is], ranks[Is]), ...);
+  }
 
-    boundries[0] = replicants;
-    for (size_t i = 1; i < index.size(); ++i) {
-      boundries[i] = dim[i - 1] * boundries[i - 1];
+  template <size_t I>
+  void sort_factor_levels(Order const& sort_order, std::vector<size_t>& levels,
+                          std::vector<size_t>& ranks) const
+  {
+    levels.clear();
+    ranks.clear();
+    if (sort_order != Order::Sorted) {
+      return;
     }
 
-    if (!end_flag) {
-      for (size_t i = 0; i < index.size(); ++i) {
-        idx += index[i] * boundries[i];
+    using level_type =
+      typename std::tuple_element_t<I, std::tuple<Factors...>>::value_type;
+    if constexpr (is_less_than_comparable_v<level_type>) {
+      size_t const dim = std::size(std::get<I>(factors));
+      std::vector<level_type> values;
+      values.reserve(dim);
+      for (size_t level = 0; level < dim; ++level) {
+        values.emplace_back(get_level<I>(level));
+      }
+      levels.resize(dim);
+      std::iota(std::begin(levels), std::end(levels), size_t{ 0 });
+      std::stable_sort(std::begin(levels), std::end(levels),
+                       [&values](size_t lhs, size_t rhs) {
+                         return values[lhs] < values[rhs];
+                       });
+      ranks.resize(dim);
+      for (size_t rank = 0; rank < dim; ++rank) {
+        ranks[levels[rank]] = rank;
       }
-      idx += replicant;
     } else {
-      idx = dim.back() * boundries.back();
+      throw std::runtime_error{
+        "sorted order requires factors whose levels are ordered by <"
+      };
     }
-
-    return idx;
   }
 
-  void from_difference_type(typename iterator::difference_type d,
-                            typename iterator::index_type& index,
-                            size_t& replicant, bool& end_flag) const
+  sweep_plan make_plan() const { return make_plan(order); }
+
+  sweep_plan make_plan(Order const& plan_order) const
   {
-    typename iterator::index_type boundries;
+    sweep_plan plan{};
+    plan.dims = tuple_to_array<size_t>(
+      tuple_transform([](auto&& factor) { return std::size(factor); }, factors));
 
-    auto dim_tuple =
-      tuple_transform([](auto&& factor) { return std::size(factor); }, factors);
-    auto dim = tuple_to_array<size_t>(dim_tuple);
+    std::iota(std::begin(plan.nesting), std::end(plan.nesting), size_t{ 0 });
+    if (plan_order == Order::Sorted) {
+      // lexicographic order varies the last factor fastest
+      std::reverse(std::begin(plan.nesting), std::end(plan.nesting));
+    } else {
+      std::stable_sort(std::begin(plan.nesting), std::end(plan.nesting),
+                       [this](size_t lhs, size_t rhs) {
+                         return change_costs[lhs] < change_costs[rhs];
+                       });
+    }
 
-    boundries[0] = replicants;
-    for (size_t i = 1; i < index.size(); ++i) {
-      boundries[i] = dim[i - 1] * boundries[i - 1];
+    size_t stride = 1;
+    size_t offset = 1;
+    for (size_t k = 0; k < plan.nesting.size(); ++k) {
+      auto i = plan.nesting[k];
+      plan.strides[i] = stride;
+      plan.offsets[k] = offset;
+      stride *= plan.dims[i];
+      offset += plan.dims[i] - 1;
     }
-    if (static_cast<size_t>(d) < boundries.back() * dim.back()) {
-      for (size_t i = index.size(); i-- > 0;) {
-        index[i] = d / boundries[i];
-        d -= (index[i] * boundries[i]);
+
+    if (plan.dims.size() != 0) {
+      switch (design) {
+        case Design::FullFactorial:
+          plan.points = std::accumulate(std::begin(plan.dims),
+                                        std::end(plan.dims), size_t{ 1 },
+                                        std::multiplies<size_t>{});
+          break;
+        case Design::OneAtATime:
+          plan.points = std::accumulate(std::begin(plan.dims),
+                                        std::end(plan.dims), size_t{ 0 },
+                                        std::plus<size_t>{}) -
+                        (plan.dims.size() - 1);
+          break;
+        case Design::LatinHypercube:
+          if (std::find(std::begin(plan.dims), std::end(plan.dims), 0) !=
+              std::end(plan.dims)) {
+            plan.points = 0;
+          } else if (samples != 0) {
+            plan.points = samples;
+          } else {
+            plan.points =
+              *std::max_element(std::begin(plan.dims), std::end(plan.dims));
+          }
+          for (size_t i = 0; i < plan.dims.size(); ++i) {
+            plan.permutations.emplace_back(
+              plan.points, seed ^ ((i + 1) * 0x9E3779B97F4A7C15ull));
+          }
+          break;
+        default:
+          throw std::runtime_error{ "invalid design" };
       }
-      replicant = d;
+    } else {
+      // if there are no factors, there is nothing to test
+      plan.points = 0;
+    }
+    plan.size = replicants * plan.points;
+    return plan;
+  }
+
+  typename iterator::difference_type to_difference_type(
+    size_t const point, size_t const replicant, bool const end_flag) const
+  {
+    if (end_flag) {
+      return plan.size;
+    }
+    return point * replicants + replicant;
+  }
+
+  void from_difference_type(typename iterator::difference_type d,
+                            size_t& point,
+                            typename iterator::index_type& index,
+                            size_t& replicant, bool& end_flag) const
+  {
+    if (d >= 0 && static_cast<size_t>(d) < plan.size) {
+      point = d / replicants;
+      replicant = d % replicants;
       end_flag = false;
+      from_point(point, index);
     } else {
       end_flag = true;
       std::fill(std::begin(index), std::end(index), 0);
+      point = 0;
       replicant = 0;
     }
   }
 
-  void next_index(typename iterator::index_type& index, bool& end_flag) const
+  /*
+   * OneAtATime visits the point with every factor at rank 0 first, then each
+   * rank > 0 of the fastest varying factor, then of the next, and so on.
+   * Returns the position in plan.nesting of the factor that is not at rank 0
+   * in point, or the number of factors for the first point.
+   */
+  size_t one_at_a_time_factor(size_t point) const
+  {
+    if (point == 0) {
+      return plan.dims.size();
+    }
+    auto next = std::upper_bound(std::begin(plan.offsets),
+                                 std::end(plan.offsets), point);
+    return std::distance(std::begin(plan.offsets), next) - 1;
+  }
+
+  /*
+   * the rank of factor i in sample point of a Latin hypercube
+   *
+   * The ranks of each factor are split into plan.points equal strata, and
+   * each factor's permutation assigns every sample its own stratum.  A
+   * hash of the seed, factor, and sample picks the rank within the stratum.
+   */
+  size_t latin_hypercube_rank(size_t point, size_t i) const
+  {
+    std::uint64_t const stratum = plan.permutations[i](point);
+    std::uint64_t jitter = seed ^ (point * 0xD1B54A32D192ED03ull) ^
+                           ((i + 1) * 0x9E3779B97F4A7C15ull);
+    jitter = (jitter ^ (jitter >> 33)) * 0xFF51AFD7ED558CCDull;
+    jitter = (jitter ^ (jitter >> 33)) * 0xC4CEB9FE1A85EC53ull;
+    jitter ^= jitter >> 33;
+    return (stratum * plan.dims[i] + jitter % plan.dims[i]) / plan.points;
+  }
+
+  void from_point(size_t point, typename iterator::index_type& index) const
   {
-    auto dim_tuple =
-      tuple_transform([](auto&& factor) { return std::size(factor); }, factors);
-    auto dim = tuple_to_array<size_t>(dim_tuple);
-    size_t i = 0;
     switch (design) {
       case Design::FullFactorial:
-        while (i < dim.size() && ++index[i] >= dim[i]) {
-          index[i++] = 0;
+        for (size_t i = 0; i < index.size(); ++i) {
+          index[i] = level_at(i, full_factorial_rank(point, i));
         }
-        end_flag = (i == dim.size());
         break;
-      case Design::OneAtATime:
-        for (; i < dim.size(); ++i) {
-          if (index[i] != 0)
-            break;
+      case Design::OneAtATime: {
+        for (size_t i = 0; i < index.size(); ++i) {
+          index[i] = level_at(i, 0);
         }
-        if (i == dim.size()) {
-          ++index[0];
-          end_flag = false;
-        } else {
-          if (++index[i] >= dim[i]) {
-            index[i++] = 0;
-            if (i < dim.size()) {
-              ++index[i];
-              end_flag = false;
-            } else {
-              end_flag = true;
+        auto k = one_at_a_time_factor(point);
+        if (k != index.size()) {
+          auto i = plan.nesting[k];
+          index[i] = level_at(i, point - plan.offsets[k] + 1);
+        }
+      } break;
+      case Design::LatinHypercube:
+        for (size_t i = 0; i < index.size(); ++i) {
+          index[i] = level_at(i, latin_hypercube_rank(point, i));
+        }
+        break;
+    }
+  }
+
+  /*
+   * the rank of factor i at point of a full factorial design
+   *
+   * point is read as a mixed-radix number whose digits are the ranks.  For
+   * Order::Gray, a digit counts down instead of up whenever the number formed
+   * by the slower digits is odd, which reflects each pass of the digit.
+   */
+  size_t full_factorial_rank(size_t point, size_t i) const
+  {
+    size_t const digit = (point / plan.strides[i]) % plan.dims[i];
+    if (order == Order::Gray &&
+        (point / (plan.strides[i] * plan.dims[i])) % 2 == 1) {
+      return plan.dims[i] - 1 - digit;
+    }
+    return digit;
+  }
+
+  /*
+   * moves to the next point, returning the factors whose level changed
+   */
+  typename iterator::change_type next_index(
+    size_t& point, typename iterator::index_type& index, bool& end_flag) const
+  {
+    typename iterator::change_type changes;
+    if (++point >= plan.points) {
+      end_flag = true;
+      return changes;
+    }
+    end_flag = false;
+    switch (design) {
+      case Design::FullFactorial: {
+        if (order == Order::Gray) {
+          // only the lowest digit that did not wrap around changes
+          for (size_t k = 0; k < plan.nesting.size(); ++k) {
+            auto i = plan.nesting[k];
+            if ((point / plan.strides[i]) % plan.dims[i] != 0) {
+              index[i] = level_at(i, full_factorial_rank(point, i));
+              changes[i] = true;
+              break;
             }
           }
+          break;
+        }
+        for (size_t k = 0; k < plan.nesting.size(); ++k) {
+          auto i = plan.nesting[k];
+          auto rank = rank_of(i, index[i]) + 1;
+          if (rank < plan.dims[i]) {
+            index[i] = level_at(i, rank);
+            changes[i] = true;
+            break;
+          }
+          // a factor with a single level wraps back to the same level
+          index[i] = level_at(i, 0);
+          changes[i] = plan.dims[i] > 1;
+        }
+      } break;
+      case Design::OneAtATime: {
+        auto last = one_at_a_time_factor(point - 1);
+        auto current = one_at_a_time_factor(point);
+        if (last != index.size()) {
+          auto i = plan.nesting[last];
+          index[i] = level_at(i, 0);
+          changes[i] = true;
+        }
+        auto i = plan.nesting[current];
+        index[i] = level_at(i, point - plan.offsets[current] + 1);
+        changes[i] = true;
+      } break;
+      case Design::LatinHypercube:
+        for (size_t i = 0; i < index.size(); ++i) {
+          auto level = level_at(i, latin_hypercube_rank(point, i));
+          changes[i] = level != index[i];
+          index[i] = level;
         }
         break;
     }
+    return changes;
+  }
+
+  template <class Columns, size_t... Is>
+  void materialize_impl(size_t start, size_t count, Columns columns,
+                        std::index_sequence<Is...>) const
+  {
+    switch (design) {
+      case Design::FullFactorial:
+        if (order != Order::Gray) {
+          (materialize_column<Is>(start, count, std::get<Is>(columns)), ...);
+          break;
+        }
+        [[fallthrough]];
+      default: {
+        auto it = begin() + start;
+        for (size_t i = 0; i < count; ++i, ++it) {
+          ((*std::get<Is>(columns)++ = std::get<Is>(*it)), ...);
+        }
+      } break;
+    }
+  }
+
+  template <size_t I, class OutputIterator>
+  void materialize_column(size_t start, size_t count,
+                          OutputIterator column) const
+  {
+    auto const& factor = std::get<I>(factors);
+    size_t const dim = plan.dims[I];
+    size_t const period = plan.strides[I] * replicants;
+    size_t level = (start / period) % dim;
+
+    if (!sorted_levels[I].empty()) {
+      // levels are visited out of order, so look each run's level up
+      size_t run = period - (start % period);
+      while (count != 0) {
+        size_t n = std::min(run, count);
+        column = std::fill_n(column, n, get_level<I>(level_at(I, level)));
+        count -= n;
+        run = period;
+        level = (level + 1 == dim) ? 0 : level + 1;
+      }
+      return;
+    }
+
+    auto current = std::next(std::begin(factor), level);
+
+    if (period == 1) {
+      // the levels appear in order, so copy them a cycle at a time
+      while (count != 0) {
+        size_t n = std::min(dim - level, count);
+        column = std::copy_n(current, n, column);
+        count -= n;
+        level = 0;
+        current = std::begin(factor);
+      }
+      return;
+    }
+
+    size_t run = period - (start % period);
+    while (count != 0) {
+      size_t n = std::min(run, count);
+      column = std::fill_n(column, n, *current);
+      count -= n;
+      run = period;
+      if (++level == dim) {
+        level = 0;
+        current = std::begin(factor);
+      } else {
+        ++current;
+      }
+    }
+  }
+
+  std::vector<size_t> get_parameters_at_index(
+    typename iterator::index_type const& indices) const
+  {
+    std::vector<size_t> parameters(parameter_arity);
+    write_parameters_at_index(indices, parameters.data());
+    return parameters;
+  }
+
+  size_t* write_parameters_at_index(
+    typename iterator::index_type const& indices, size_t* out) const
+  {
+    return write_parameters_at_index_impl(
+      indices, out, std::index_sequence_for<Factors...>{});
+  }
+
+  template <size_t... Is>
+  size_t* write_parameters_at_index_impl(
+    typename iterator::index_type const& indices, size_t* out,
+    std::index_sequence<Is...>) const
+  {
+    ((out = write_parameters_of(std::get<Is>(factors), indices[Is], out)),
+     ...);
+    return out;
+  }
+
+  // looks up a level through the fastest path the factor supports
+  template <size_t I>
+  level_reference_t<std::tuple_element_t<I, std::tuple<Factors...>>> get_level(
+    size_t index) const
+  {
+    using factor_type = std::tuple_element_t<I, std::tuple<Factors...>>;
+    auto const& factor = std::get<I>(factors);
+    if constexpr (has_stable_subscript_v<factor_type>) {
+      return factor[index];
+    } else {
+      if constexpr (!is_random_access_v<factor_type>) {
+        auto const& level_index = std::get<I>(level_indices);
+        if (!level_index.empty()) {
+          return level_index[index];
+        }
+      }
+      return *std::next(std::begin(factor), index);
+    }
+  }
+
+  template <size_t... Is>
+  typename cursor::reference get_reference_at_index(
+    typename iterator::index_type const& index,
+    std::index_sequence<Is...>) const
+  {
+    return typename cursor::reference(get_level<Is>(index[Is])...);
   }
 
   typename iterator::value_type get_value_at_index(
     typename iterator::index_type const& index_a) const
   {
-    auto index = array_to_tuple(index_a);
-    auto values = tuple_transform(
-      [](auto&& factor, auto const& index) {
-        return *std::next(std::begin(factor), index);
-      },
-      factors, index);
-    return values;
+    return get_value_at_index_impl(index_a,
+                                   std::index_sequence_for<Factors...>{});
+  }
+
+  template <size_t... Is>
+  typename iterator::value_type get_value_at_index_impl(
+    typename iterator::index_type const& index,
+    std::index_sequence<Is...>) const
+  {
+    return typename iterator::value_type(get_level<Is>(index[Is])...);
+  }
+
+  void update_value_at_index(typename iterator::index_type const& index,
+                             typename iterator::change_type const& changes,
+                             typename iterator::value_type& value) const
+  {
+    update_value_at_index_impl(index, changes, value,
+                               std::index_sequence_for<Factors...>{});
+  }
+
+  template <size_t... Is>
+  void update_value_at_index_impl(
+    typename iterator::index_type const& index,
+    typename iterator::change_type const& changes,
+    typename iterator::value_type& value, std::index_sequence<Is...>) const
+  {
+    ((changes[Is] ? (void)(std::get<Is>(value) = get_level<Is>(index[Is]))
+                  : void()),
+     ...);
   }
 };
 
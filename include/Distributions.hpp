@@ -1,13 +1,161 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <random>
 #include <tuple>
+
+/*
+ * The Philox4x32-10 counter based random number engine (Salmon et al. 2011)
+ *
+ * Each block of four outputs is a keyed bijection of a 128 bit counter, so
+ * any position of any stream can be computed directly.  The key holds the
+ * seed, the high half of the counter selects a stream, and the low half
+ * counts blocks within the stream.
+ */
+class Philox4x32
+{
+public:
+  using result_type = std::uint32_t;
+  using counter_type = std::array<std::uint32_t, 4>;
+  using key_type = std::array<std::uint32_t, 2>;
+
+  explicit Philox4x32(std::uint64_t seed = 0, std::uint64_t stream = 0)
+  {
+    this->seed(seed, stream);
+  }
+
+  void seed(std::uint64_t seed, std::uint64_t stream = 0)
+  {
+    key = { static_cast<std::uint32_t>(seed),
+            static_cast<std::uint32_t>(seed >> 32) };
+    counter = { 0, 0, static_cast<std::uint32_t>(stream),
+                static_cast<std::uint32_t>(stream >> 32) };
+    index = 4;
+  }
+
+  // takes the seed and stream from the first four words of seq
+  void seed(std::seed_seq& seq)
+  {
+    std::array<std::uint32_t, 4> words;
+    seq.generate(std::begin(words), std::end(words));
+    seed((static_cast<std::uint64_t>(words[1]) << 32) | words[0],
+         (static_cast<std::uint64_t>(words[3]) << 32) | words[2]);
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max()
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  /*
+   * writes the next count outputs to out; whole blocks are written directly
+   * so that the rounds of independent counters can be vectorized
+   */
+  void generate(result_type* out, size_t count)
+  {
+    while (count != 0 && index != 4) {
+      *out++ = (*this)();
+      --count;
+    }
+    std::uint64_t const first = position();
+    size_t const blocks = count / 4;
+    for (size_t b = 0; b < blocks; ++b) {
+      std::uint64_t const block_position = first + b;
+      counter_type block_counter = {
+        static_cast<std::uint32_t>(block_position),
+        static_cast<std::uint32_t>(block_position >> 32), counter[2], counter[3]
+      };
+      counter_type const values = block(block_counter, key);
+      std::copy(std::begin(values), std::end(values), out + 4 * b);
+    }
+    set_position(first + blocks);
+    out += 4 * blocks;
+    for (count -= 4 * blocks; count != 0; --count) {
+      *out++ = (*this)();
+    }
+  }
+
+  result_type operator()()
+  {
+    if (index == 4) {
+      buffer = block(counter, key);
+      set_position(position() + 1);
+      index = 0;
+    }
+    return buffer[index++];
+  }
+
+  // skips n outputs in constant time
+  void discard(unsigned long long n)
+  {
+    std::uint64_t const output = (position() - (index == 4 ? 0 : 1)) * 4 +
+                                 (index == 4 ? 0 : index) + n;
+    set_position(output / 4);
+    index = 4;
+    if (output % 4 != 0) {
+      (*this)();
+      index = static_cast<unsigned>(output % 4);
+    }
+  }
+
+  // the ten round Philox bijection of counter under key
+  static counter_type block(counter_type counter, key_type key)
+  {
+    for (int round = 0; round < 10; ++round) {
+      if (round != 0) {
+        key[0] += 0x9E3779B9u;
+        key[1] += 0xBB67AE85u;
+      }
+      std::uint64_t const product0 = std::uint64_t{ 0xD2511F53u } * counter[0];
+      std::uint64_t const product1 = std::uint64_t{ 0xCD9E8D57u } * counter[2];
+      counter = { static_cast<std::uint32_t>(product1 >> 32) ^ counter[1] ^
+                    key[0],
+                  static_cast<std::uint32_t>(product1),
+                  static_cast<std::uint32_t>(product0 >> 32) ^ counter[3] ^
+                    key[1],
+                  static_cast<std::uint32_t>(product0) };
+    }
+    return counter;
+  }
+
+private:
+  // the index of the next block within the stream
+  std::uint64_t position() const
+  {
+    return (static_cast<std::uint64_t>(counter[1]) << 32) | counter[0];
+  }
+  void set_position(std::uint64_t position)
+  {
+    counter[0] = static_cast<std::uint32_t>(position);
+    counter[1] = static_cast<std::uint32_t>(position >> 32);
+  }
+
+  key_type key;
+  counter_type counter;
+  counter_type buffer;
+  unsigned index;
+};
 template <class T>
 class RandomNumberGenerator
 {
 public:
   using result_type = T;
   virtual T operator()() = 0;
+  /*
+   * writes the next count values to out; equivalent to calling operator()
+   * count times, but with one virtual call for the whole batch
+   */
+  virtual void generate(T* out, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = (*this)();
+    }
+  }
   virtual void seed(T value) = 0;
   virtual void seed(size_t value) = 0;
   virtual void seed(std::seed_seq seq) = 0;
@@ -32,6 +180,13 @@ public:
   {
     return dist(gen);
   }
+  void generate(typename RandomNumberDistribution::result_type* out,
+                size_t count) final
+  {
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = dist(gen);
+    }
+  }
   void seed(typename RandomNumberDistribution::result_type value) override
   {
     return gen.seed(value);
@@ -59,3 +214,27 @@ make_dist_from_tuple(Tuple&& tuple)
     std::make_from_tuple<RandomNumberDistribution>(std::forward<Tuple>(tuple));
   return make_dist(gen, dist);
 }
+
+/*
+ * returns the generator for stream of the sweep seeded with seed
+ *
+ * streams are independent of each other and constructed in constant time,
+ * so each thread, shard, or sweep point (e.g. Builder::iterator::get_id(),
+ * which distinguishes replicants) can use its own stream and still produce
+ * the same values regardless of how the work is divided
+ */
+inline Philox4x32
+make_stream(std::uint64_t seed, std::uint64_t stream)
+{
+  return Philox4x32(seed, stream);
+}
+
+template <class RandomNumberDistribution, class Tuple>
+std::shared_ptr<
+  RandomNumberGenerator<typename RandomNumberDistribution::result_type>>
+make_dist_from_tuple(Tuple&& tuple, std::uint64_t seed, std::uint64_t stream)
+{
+  auto dist =
+    std::make_from_tuple<RandomNumberDistribution>(std::forward<Tuple>(tuple));
+  return make_dist(make_stream(seed, stream), dist);
+}
@@ -1,11 +1,15 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
 #include <iterator>
 #include <numeric>
 #include <tuple>
+#include <utility>
 #include <vector>
 
+#include "LevelIndex.hpp"
 #include "tuple_algorithms.hpp"
 #include "type_traits.hpp"
 
@@ -15,8 +19,15 @@ template <class... Containers>
 class Factor
 {
 public:
+  // the active container followed by the parameters of every container
+  static constexpr size_t parameter_arity =
+    1 + (parameter_arity_v<Containers> + ... + 0);
+  using parameters_type = std::array<size_t, parameter_arity>;
+
   Factor(Containers... containers)
     : containers(std::forward_as_tuple(containers...))
+    , level_indices(LevelIndex<Containers>(containers)...)
+    , boundries(make_boundries())
   {}
 
   class iterator
@@ -177,6 +188,19 @@ public:
       return factor->get_parameters(d);
     }
 
+    parameters_type get_parameter_array() const
+    {
+      parameters_type parameters;
+      write_parameters(parameters.data());
+      return parameters;
+    }
+
+    size_t* write_parameters(size_t* out) const
+    {
+      difference_type d = factor->to_difference_type(index, end_flag);
+      return factor->write_parameters(d, out);
+    }
+
   private:
     Factor const* get_real_factor_or_null(iterator const& rhs) const
     {
@@ -209,61 +233,79 @@ public:
 
   size_t size() const
   {
-    auto sizes = tuple_transform(
-      [](auto& container) { return std::size(container); }, containers);
-    auto sizes_a = tuple_to_array<size_t>(sizes);
-    return std::accumulate(std::begin(sizes_a), std::end(sizes_a), 0);
+    if constexpr (sizeof...(Containers) != 0) {
+      return boundries.back();
+    } else {
+      return 0;
+    }
+  }
+
+  /*
+   * containers whose iterators are not random access are copied into a
+   * random access index on construction; passing false releases the copies
+   */
+  Factor& set_level_index(bool enabled)
+  {
+    if (enabled) {
+      level_indices = std::apply(
+        [](auto const&... container) {
+          return std::make_tuple(
+            LevelIndex<std::decay_t<decltype(container)>>(container)...);
+        },
+        containers);
+    } else {
+      std::apply([](auto&... index) { (index.clear(), ...); }, level_indices);
+    }
+    return *this;
   }
 
   std::vector<size_t> get_parameters(size_t d) const
+  {
+    std::vector<size_t> parameters(parameter_arity);
+    write_parameters(d, parameters.data());
+    return parameters;
+  }
+
+  /*
+   * writes the parameter_arity parameters of level d to out, returning the
+   * end of what was written
+   */
+  size_t* write_parameters(size_t d, size_t* out) const
   {
     typename iterator::index_type index;
     bool end_flag;
     from_difference_type(d, index, end_flag);
 
-    std::array<size_t, std::tuple_size<std::tuple<Containers...>>::value>
-      multi_index{};
-    multi_index[index.container_index] = index.element_index;
-    auto multi_index_tuple = array_to_tuple(multi_index);
-
-    auto params_t = tuple_transform(
-      [](auto const& index, auto const& container) -> std::vector<size_t> {
-        if constexpr (is_builder_v<std::decay_t<decltype(container)>>) {
-          return container.get_parameters(index);
-        } else {
-          return std::vector<size_t>{ index };
-        }
-      },
-      multi_index_tuple, containers);
-    auto params_a = tuple_to_array<std::vector<size_t>>(params_t);
-
-    std::vector<size_t> params_v;
-    params_v.push_back(index.container_index);
-    for (auto const& param : params_a) {
-      for (auto const& entry : param) {
-        params_v.push_back(entry);
-      }
-    }
-    return params_v;
+    *out++ = index.container_index;
+    return write_parameters_impl(index, out,
+                                 std::index_sequence_for<Containers...>{});
   }
 
 private:
   std::tuple<Containers...> containers;
+  std::tuple<LevelIndex<Containers>...> level_indices;
+  // the level one past the end of each container
+  std::array<size_t, sizeof...(Containers)> boundries;
 
-  typename iterator::difference_type to_difference_type(
-    typename iterator::index_type const& index, bool const end_flag) const
+  std::array<size_t, sizeof...(Containers)> make_boundries() const
   {
     auto sizes = tuple_transform(
       [](auto const& container) { return std::size(container); }, containers);
     auto boundries = tuple_to_array<std::size_t>(sizes);
     std::partial_sum(std::begin(boundries), std::end(boundries),
                      std::begin(boundries));
+    return boundries;
+  }
+
+  typename iterator::difference_type to_difference_type(
+    typename iterator::index_type const& index, bool const end_flag) const
+  {
     if (!end_flag) {
       auto last_boundry =
         (index.container_index == 0) ? 0 : boundries[index.container_index - 1];
       return last_boundry + index.element_index;
     } else {
-      return boundries.back();
+      return size();
     }
   }
 
@@ -271,15 +313,9 @@ private:
                             typename iterator::index_type& index,
                             bool& end_flag) const
   {
-    auto sizes = tuple_transform(
-      [](auto const& container) { return std::size(container); }, containers);
-    auto boundries = tuple_to_array<std::size_t>(sizes);
-    std::partial_sum(std::begin(boundries), std::end(boundries),
-                     std::begin(boundries));
-
-    end_flag = (static_cast<size_t>(d) == boundries.back());
-    auto container =
-      std::upper_bound(std::begin(boundries), std::end(boundries), d);
+    end_flag = (static_cast<size_t>(d) == size());
+    auto container = std::upper_bound(
+      std::begin(boundries), std::end(boundries), static_cast<size_t>(d));
     auto container_idx = std::distance(std::begin(boundries), container);
 
     index.container_index = container_idx;
@@ -290,14 +326,24 @@ private:
     }
   }
 
+  template <size_t... Is>
+  size_t* write_parameters_impl(typename iterator::index_type const& index,
+                                size_t* out, std::index_sequence<Is...>) const
+  {
+    ((out = write_parameters_of(std::get<Is>(containers),
+                                (Is == index.container_index)
+                                  ? index.element_index
+                                  : 0,
+                                out)),
+     ...);
+    return out;
+  }
+
   void next_index(typename iterator::index_type& index, bool& end_flag) const
   {
-    size_t size_current_container;
-    apply_to_elm(
-      [&size_current_container](auto& container) {
-        size_current_container = std::size(container);
-      },
-      containers, index.container_index);
+    size_t size_current_container =
+      boundries[index.container_index] -
+      ((index.container_index == 0) ? 0 : boundries[index.container_index - 1]);
     if (++index.element_index >= size_current_container) {
       ++index.container_index;
       index.element_index = 0;
@@ -314,13 +360,22 @@ private:
   void get_value(typename iterator::index_type& index,
                  typename iterator::reference value) const
   {
-    size_t& container_index = index.container_index;
-    size_t& element_index = index.element_index;
-    apply_to_elm(
-      [&element_index, &value](auto&& container) {
+    size_t const element_index = index.element_index;
+    visit_index<sizeof...(Containers)>(
+      [this, element_index, &value](auto i) {
+        using container_type =
+          std::tuple_element_t<i, std::tuple<Containers...>>;
+        auto const& container = std::get<i>(containers);
+        if constexpr (!is_random_access_v<container_type>) {
+          auto const& level_index = std::get<i>(level_indices);
+          if (!level_index.empty()) {
+            value = level_index[element_index];
+            return;
+          }
+        }
         value = *std::next(std::begin(container), element_index);
       },
-      containers, container_index);
+      index.container_index);
   }
 };
 
@@ -1,14 +1,130 @@
 #pragma once
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <cmath>
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include "Distributions.hpp"
 #include "type_traits.hpp"
 
 namespace ParameterSweep {
+/*
+ * A random access iterator over factors that compute each level from its
+ * position with get_level rather than from the previous level
+ */
+template <class Factor>
+class LevelIterator
+{
+public:
+  using value_type = typename Factor::value_type;
+  using reference = value_type const&;
+  using pointer = value_type const*;
+  using difference_type = std::ptrdiff_t;
+  using iterator_category = std::random_access_iterator_tag;
+
+  LevelIterator()
+    : factor(nullptr)
+    , position(0)
+    , value()
+  {}
+  LevelIterator(Factor const* factor, size_t position)
+    : factor(factor)
+    , position(position)
+    , value()
+  {
+    update();
+  }
+
+  bool operator==(LevelIterator const& it) const
+  {
+    auto e1 = is_endptr();
+    auto e2 = it.is_endptr();
+    return (e1 && e2) ||
+           (!e1 && !e2 && position == it.position && factor == it.factor);
+  }
+  bool operator!=(LevelIterator const& it) const { return !(*this == it); }
+  bool operator<(LevelIterator const& it) const { return (*this - it) < 0; }
+  bool operator>(LevelIterator const& it) const { return it < *this; }
+  bool operator<=(LevelIterator const& it) const { return !(it < *this); }
+  bool operator>=(LevelIterator const& it) const { return !(*this < it); }
+
+  reference operator*() const { return value; }
+  pointer operator->() const { return &value; }
+  value_type operator[](difference_type n) const { return *(*this + n); }
+
+  LevelIterator& operator++() { return *this += 1; }
+  LevelIterator operator++(int)
+  {
+    LevelIterator tmp = *this;
+    ++(*this);
+    return tmp;
+  }
+  LevelIterator& operator--() { return *this -= 1; }
+  LevelIterator operator--(int)
+  {
+    LevelIterator tmp = *this;
+    --(*this);
+    return tmp;
+  }
+  LevelIterator& operator+=(difference_type n)
+  {
+    position += n;
+    update();
+    return *this;
+  }
+  LevelIterator& operator-=(difference_type n) { return *this += (-n); }
+  LevelIterator operator+(difference_type n) const
+  {
+    LevelIterator tmp = *this;
+    tmp += n;
+    return tmp;
+  }
+  LevelIterator operator-(difference_type n) const { return *this + (-n); }
+  difference_type operator-(LevelIterator const& it) const
+  {
+    return static_cast<difference_type>(position_or_end(it)) -
+           static_cast<difference_type>(it.position_or_end(*this));
+  }
+
+private:
+  void update()
+  {
+    if (!is_endptr()) {
+      value = factor->get_level(position);
+    }
+  }
+  bool is_endptr() const
+  {
+    return factor == nullptr || position >= factor->size();
+  }
+  // default constructed iterators are end iterators of any factor
+  size_t position_or_end(LevelIterator const& it) const
+  {
+    if (factor != nullptr) {
+      return position;
+    } else if (it.factor != nullptr) {
+      return it.factor->size();
+    } else {
+      return 0;
+    }
+  }
+
+  Factor const* factor;
+  size_t position;
+  value_type value;
+};
+
 /*
  * A class that represents values at standard deviations above and below the
  * mean
@@ -27,66 +143,23 @@ public:
   }
 
   using value_type = NumericType;
-  class iterator
-  {
-  public:
-    using value_type = NumericType;
-    using reference = value_type const&;
-    using pointer = value_type const*;
-    using difference_type = std::ptrdiff_t;
-    using iterator_category = std::forward_iterator_tag;
+  using iterator = LevelIterator<NormalFactor>;
 
-    iterator()
-      : value()
-      , factor(nullptr)
-    {}
-    iterator(NormalFactor const* factor)
-      : value(factor->mean - (factor->levels * factor->stddev))
-      , factor(factor)
-    {}
-    bool operator==(iterator const& it) const
-    {
-      auto e1 = is_endptr();
-      auto e2 = it.is_endptr();
-      return (e1 && e2) ||
-             (!e1 && !e2 && value == it.value && factor == it.factor);
-    }
-    bool operator!=(iterator const& it) const { return !(*this == it); }
-    reference operator*() { return value; }
-    reference operator->() { return value; }
-    iterator& operator=(iterator const& it)
-    {
-      value = it.value;
-      factor = it.factor;
-      return *this;
-    }
-    iterator& operator++()
-    {
-      value += factor->stddev;
-      return *this;
-    }
-    iterator operator++(int)
-    {
-      iterator tmp = *this;
-      ++(*this);
-      return tmp;
-    }
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size()); }
+  size_t size() const { return levels * 2 + 1; };
 
-  private:
-    bool is_endptr() const
-    {
-      return (factor == nullptr) || (value > factor->end_point());
+  // the value k - levels standard deviations from the mean
+  NumericType get_level(size_t k) const
+  {
+    if (k < levels) {
+      return mean - static_cast<NumericType>(levels - k) * stddev;
+    } else {
+      return mean + static_cast<NumericType>(k - levels) * stddev;
     }
-    NumericType value;
-    NormalFactor const* factor;
-  };
-
-  iterator begin() const { return iterator(this); }
-  iterator end() const { return iterator(); }
-  size_t size() const { return levels * 2 + 1; };
+  }
 
 private:
-  inline NumericType end_point() const { return (levels * stddev) + mean; }
   NumericType mean, stddev;
   size_t levels;
 };
@@ -98,9 +171,19 @@ template <class T>
 struct Arithmatic
 {
   static T increment(T current, T increment) { return current + increment; }
+  static T level(T min, T increment, size_t k)
+  {
+    return min + static_cast<T>(k) * increment;
+  }
   static T step_size(T min, T max, size_t levels)
   {
-    return (max - min + 1) / levels;
+    if constexpr (std::is_floating_point<T>::value) {
+      // floating point ranges include both end points
+      return (levels > 1) ? (max - min) / static_cast<T>(levels - 1)
+                          : (max - min);
+    } else {
+      return (max - min + 1) / levels;
+    }
   }
 
   static bool valid(T val) { return val > 0; }
@@ -110,6 +193,26 @@ template <class T>
 struct Geometric
 {
   static T increment(T current, T increment) { return current * increment; }
+  static T level(T min, T increment, size_t k)
+  {
+    if constexpr (std::is_integral<T>::value) {
+      // exponentiation by squaring is exact for integers
+      T result = min;
+      T base = increment;
+      while (k != 0) {
+        if (k & 1) {
+          result *= base;
+        }
+        k >>= 1;
+        if (k != 0) {
+          base *= base;
+        }
+      }
+      return result;
+    } else {
+      return min * std::pow(increment, static_cast<T>(k));
+    }
+  }
   static T step_size(T min, T max, size_t levels)
   {
     double ret =
@@ -142,70 +245,101 @@ public:
 
   NumericType get_max() const { return max; }
   NumericType get_min() const { return min; }
-  NumericType get_step_size() const { return step_size(); }
+  NumericType get_step_size() const { return step_size; }
 
   using value_type = NumericType;
-  class iterator
-  {
-  public:
-    using value_type = NumericType;
-    using reference = value_type const&;
-    using pointer = value_type const*;
-    using difference_type = std::ptrdiff_t;
-    using iterator_category = std::forward_iterator_tag;
+  using iterator = LevelIterator<RangeFactor>;
 
-    iterator()
-      : value()
-      , factor(nullptr)
-    {}
-    iterator(RangeFactor const* factor)
-      : value(factor->min)
-      , factor(factor)
-    {}
-    bool operator==(iterator const& it) const
-    {
-      auto e1 = is_endptr();
-      auto e2 = it.is_endptr();
-      return (e1 && e2) ||
-             (!e1 && !e2 && value == it.value && factor == it.factor);
-    }
-    bool operator!=(iterator const& it) const { return !(*this == it); }
-    reference operator*() { return value; }
-    reference operator->() { return value; }
-    iterator& operator=(iterator const& it)
-    {
-      value = it.value;
-      factor = it.factor;
-      return *this;
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size()); }
+  size_t size() const { return levels; }
+
+  // computed directly so that error does not accumulate between levels
+  NumericType get_level(size_t k) const
+  {
+    if constexpr (std::is_floating_point<NumericType>::value) {
+      if (levels > 1 && k == levels - 1) {
+        return max;
+      }
     }
-    iterator& operator++()
-    {
-      value = Step::increment(value, factor->step_size);
-      return *this;
+    return Step::level(min, step_size, k);
+  }
+
+private:
+  NumericType min, max, step_size;
+  size_t levels;
+};
+
+/*
+ * A class that represents values evenly spaced on a log scale between min and
+ * max inclusive
+ *
+ * The levels are computed once into a table.  For integral types the levels
+ * are rounded and duplicates removed, so size() may be less than the number
+ * of levels requested when the range is too narrow to hold them all.
+ */
+template <class NumericType>
+class LogRangeFactor
+{
+public:
+  LogRangeFactor(NumericType min, NumericType max, size_t levels)
+    : values(make_levels(min, max, levels))
+  {}
+
+  NumericType get_max() const { return values.back(); }
+  NumericType get_min() const { return values.front(); }
+
+  using value_type = NumericType;
+  using iterator = typename std::vector<NumericType>::const_iterator;
+
+  iterator begin() const { return std::begin(values); }
+  iterator end() const { return std::end(values); }
+  size_t size() const { return std::size(values); }
+  NumericType const& operator[](size_t k) const { return values[k]; }
+
+private:
+  static std::vector<NumericType> make_levels(NumericType min, NumericType max,
+                                              size_t levels)
+  {
+    assert(min > NumericType(0) && "the min should be greater than 0");
+    assert(min < max && "the max should be greater than the min");
+    assert(levels > 1 && "there should be at least 2 levels");
+
+    // exponents are written out first so the exp loop can be vectorized
+    double const log_min = std::log(static_cast<double>(min));
+    double const log_step = (std::log(static_cast<double>(max)) - log_min) /
+                            static_cast<double>(levels - 1);
+    std::vector<double> exponents(levels);
+    for (size_t k = 0; k < levels; ++k) {
+      exponents[k] = log_min + static_cast<double>(k) * log_step;
     }
-    iterator operator++(int)
-    {
-      iterator tmp = *this;
-      ++(*this);
-      return tmp;
+    for (size_t k = 0; k < levels; ++k) {
+      exponents[k] = std::exp(exponents[k]);
     }
 
-  private:
-    bool is_endptr() const
-    {
-      return factor == nullptr || (value > factor->max);
+    std::vector<NumericType> values(levels);
+    if constexpr (std::is_integral<NumericType>::value) {
+      std::transform(std::begin(exponents), std::end(exponents),
+                     std::begin(values), [](double level) {
+                       return static_cast<NumericType>(std::llround(level));
+                     });
+    } else {
+      std::copy(std::begin(exponents), std::end(exponents),
+                std::begin(values));
     }
-    NumericType value;
-    RangeFactor const* factor;
-  };
+    // the end points are exact regardless of rounding in exp and log
+    values.front() = min;
+    values.back() = max;
 
-  iterator begin() const { return iterator(this); }
-  iterator end() const { return iterator(); }
-  size_t size() const { return levels; }
+    if constexpr (std::is_integral<NumericType>::value) {
+      values.erase(std::unique(std::begin(values), std::end(values)),
+                   std::end(values));
+    }
+    values.shrink_to_fit();
+    return values;
+  }
 
-private:
-  NumericType min, max, step_size;
-  size_t levels;
+  std::vector<NumericType> values;
 };
 
 template <class NumericType, class RandomNumberGenerator>
@@ -216,7 +350,13 @@ public:
     : values(levels)
     , gen(gen)
   {
-    std::generate(std::begin(values), std::end(values), gen);
+    if constexpr (has_generate_v<RandomNumberGenerator>) {
+      // drawn from a copy like std::generate so gen keeps its initial state
+      RandomNumberGenerator batch = gen;
+      batch.generate(values.data(), levels);
+    } else {
+      std::generate(std::begin(values), std::end(values), gen);
+    }
   }
   using iterator = typename std::vector<NumericType>::const_iterator;
   using value_type = NumericType;
@@ -235,18 +375,101 @@ RandomFactor(RandomNumberGenerator gen, size_t levels)
   ->RandomFactor<decltype(std::declval<RandomNumberGenerator>()()),
                  RandomNumberGenerator>;
 
+/*
+ * A class that represents random values where each level is drawn from its
+ * own Philox stream keyed by the seed, so any level can be computed directly
+ * without storing or generating the levels before it
+ */
+template <class RandomNumberDistribution>
+class CounterRandomFactor
+{
+public:
+  CounterRandomFactor(RandomNumberDistribution dist, size_t levels,
+                      std::uint64_t seed = 0)
+    : dist(dist)
+    , levels(levels)
+    , seed(seed)
+  {}
+
+  using value_type = typename RandomNumberDistribution::result_type;
+  using iterator = LevelIterator<CounterRandomFactor>;
+
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, size()); }
+  size_t size() const { return levels; }
+  std::uint64_t get_seed() const { return seed; }
+
+  value_type get_level(size_t k) const
+  {
+    Philox4x32 engine(seed, k);
+    RandomNumberDistribution level_dist = dist;
+    return level_dist(engine);
+  }
+
+private:
+  RandomNumberDistribution dist;
+  size_t levels;
+  std::uint64_t seed;
+};
+
+/*
+ * calls Outer on the result of Inner; used to fuse a transform of a transform
+ * into a single layer
+ */
+template <class Inner, class Outer>
+struct ComposedTransform
+{
+  ComposedTransform(Inner inner, Outer outer)
+    : inner(std::move(inner))
+    , outer(std::move(outer))
+  {}
+
+  template <class Level>
+  auto operator()(Level&& level) const
+  {
+    auto&& inner_level = inner(std::forward<Level>(level));
+    return outer(inner_level);
+  }
+
+  Inner inner;
+  Outer outer;
+};
+
 template <class Transform, class Container>
 class TransformFactor
 {
 private:
+  template <class, class>
+  friend class TransformFactor;
+
   Container container;
   Transform func;
 
 public:
+  using transform_type = Transform;
+  using container_type = Container;
+
+  // transforms of sweeps report the parameters of the sweep
+  static constexpr size_t parameter_arity =
+    is_builder_it_v<typename Container::iterator> ? parameter_arity_v<Container>
+                                                  : 1;
+  using parameters_type = std::array<size_t, parameter_arity>;
+
   TransformFactor(Container container, Transform&& func)
     : container(container)
     , func(std::forward<Transform>(func))
   {}
+
+  /*
+   * applies both functions from a single layer over the inner factor's
+   * container; see compose
+   */
+  template <class Inner, class Outer>
+  TransformFactor(TransformFactor<Inner, Container> const& inner,
+                  Outer&& outer)
+    : container(inner.container)
+    , func(inner.func, std::forward<Outer>(outer))
+  {}
   class iterator
   {
   public:
@@ -262,27 +485,31 @@ public:
     iterator(TransformFactor const* factor)
       : factor(factor)
       , current(std::begin(factor->container))
-      , value(factor->func(*current))
+      , position(0)
+      , value(factor->evaluate(position, current))
     {}
     iterator()
       : factor(nullptr)
       , current()
+      , position(0)
       , value()
     {}
 
     iterator& operator++()
     {
       current++;
+      position++;
       if (current != std::end(factor->container)) {
-        value = factor->func(*current);
+        value = factor->evaluate(position, current);
       }
       return *this;
     }
     iterator& operator--()
     {
       current--;
+      position--;
       if (current != std::end(factor->container)) {
-        value = factor->func(*current);
+        value = factor->evaluate(position, current);
       }
       return *this;
     }
@@ -308,8 +535,9 @@ public:
     iterator& operator+=(difference_type n)
     {
       current += n;
+      position += n;
       if (current != std::end(factor->container)) {
-        value = factor->func(*current);
+        value = factor->evaluate(position, current);
       }
       return *this;
     }
@@ -325,10 +553,11 @@ public:
     }
     value_type operator[](size_t n) const
     {
-      return factor->func(*(current + n));
+      return factor->evaluate(position + n, current + n);
     }
 
     reference operator*() { return value; }
+    value_type const& operator*() const { return value; }
     reference operator->() { return value; }
     bool operator==(iterator const& it) const
     {
@@ -345,12 +574,21 @@ public:
 
     std::vector<std::size_t> get_parameters() const
     {
-      if constexpr (is_builder_it_v<typename Container::iterator>) {
-        return current.get_parameters();
-      } else {
-        return std::vector<size_t>{ static_cast<size_t>(
-          std::distance(factor->begin(), *this)) };
-      }
+      std::vector<std::size_t> parameters(parameter_arity);
+      write_parameters(parameters.data());
+      return parameters;
+    }
+
+    parameters_type get_parameter_array() const
+    {
+      parameters_type parameters;
+      write_parameters(parameters.data());
+      return parameters;
+    }
+
+    size_t* write_parameters(size_t* out) const
+    {
+      return factor->write_parameters(position, out);
     }
 
   private:
@@ -360,20 +598,176 @@ public:
     }
     TransformFactor const* factor;
     typename Container::iterator current;
+    size_t position;
     value_type value;
   };
   using value_type = typename iterator::value_type;
 
+  /*
+   * evaluate func at most once per level of the container and keep the
+   * results of the first max_levels distinct levels visited; other levels are
+   * evaluated on every visit.  copies of the factor, such as those held by a
+   * Builder, share the same results.  passing false releases the results and
+   * evaluates func on every visit
+   */
+  TransformFactor& set_memoize(
+    bool enabled, size_t max_levels = std::numeric_limits<size_t>::max())
+  {
+    if (enabled) {
+      cache = std::make_shared<memo_cache>(max_levels);
+    } else {
+      cache.reset();
+    }
+    return *this;
+  }
+
+  /*
+   * applies func to every level at once, returning the results in level
+   * order.  The levels are gathered into a contiguous array first so that
+   * arithmetic transforms can be vectorized
+   */
+  std::vector<value_type> evaluate_all() const
+  {
+    using level_type = std::decay_t<typename std::iterator_traits<
+      typename Container::iterator>::reference>;
+    std::vector<level_type> levels(std::begin(container), std::end(container));
+    std::vector<value_type> results(levels.size());
+    level_type* level_data = levels.data();
+    value_type* result_data = results.data();
+    for (size_t k = 0; k < levels.size(); ++k) {
+      result_data[k] = func(level_data[k]);
+    }
+    return results;
+  }
+
+  /*
+   * evaluates every level up front with evaluate_all and reads levels from
+   * the results; copies of the factor share the results.  passing false
+   * releases the results
+   */
+  TransformFactor& set_bulk(bool enabled)
+  {
+    if (enabled) {
+      bulk = std::make_shared<std::vector<value_type> const>(evaluate_all());
+    } else {
+      bulk.reset();
+    }
+    return *this;
+  }
+
   std::vector<std::size_t> get_parameters(std::size_t index) const
   {
-    std::vector<std::size_t> params;
-    auto it = std::next(begin(), index);
-    return it.get_parameters();
+    std::vector<std::size_t> parameters(parameter_arity);
+    write_parameters(index, parameters.data());
+    return parameters;
+  }
+
+  /*
+   * writes the parameter_arity parameters of level index to out, returning
+   * the end of what was written
+   */
+  std::size_t* write_parameters(std::size_t index, std::size_t* out) const
+  {
+    if constexpr (is_builder_it_v<typename Container::iterator>) {
+      return write_parameters_of(container, index, out);
+    } else {
+      *out = index;
+      return out + 1;
+    }
   }
 
   iterator begin() const { return iterator(this); }
   iterator end() const { return iterator(); }
   size_t size() const { return std::size(container); }
+
+private:
+  /*
+   * the results of func by level, filled in as levels are first visited.
+   * slots are only allocated for the levels that are kept, and each has its
+   * own once_flag so that threads visiting different levels do not wait on
+   * each other
+   */
+  class memo_cache
+  {
+  public:
+    explicit memo_cache(size_t max_levels)
+      : max_levels(max_levels)
+    {}
+
+    template <class Evaluate>
+    value_type get(size_t level, Evaluate&& evaluate)
+    {
+      slot* entry = find_or_insert(level);
+      if (entry == nullptr) {
+        return evaluate();
+      }
+      std::call_once(entry->once, [&] {
+        entry->value = std::make_unique<value_type const>(evaluate());
+      });
+      return *entry->value;
+    }
+
+  private:
+    struct slot
+    {
+      std::once_flag once;
+      std::unique_ptr<value_type const> value;
+    };
+
+    // returns nullptr once max_levels other levels have slots
+    slot* find_or_insert(size_t level)
+    {
+      {
+        std::shared_lock<std::shared_mutex> guard(lock);
+        auto found = slots.find(level);
+        if (found != std::end(slots)) {
+          return found->second.get();
+        }
+      }
+      std::unique_lock<std::shared_mutex> guard(lock);
+      auto found = slots.find(level);
+      if (found != std::end(slots)) {
+        return found->second.get();
+      }
+      if (slots.size() >= max_levels) {
+        return nullptr;
+      }
+      return slots.emplace(level, std::make_unique<slot>())
+        .first->second.get();
+    }
+
+    size_t const max_levels;
+    std::shared_mutex lock;
+    std::unordered_map<size_t, std::unique_ptr<slot>> slots;
+  };
+
+  value_type evaluate(size_t level,
+                      typename Container::iterator const& it) const
+  {
+    if (bulk) {
+      return (*bulk)[level];
+    } else if (cache) {
+      return cache->get(level, [&] { return func(*it); });
+    }
+    return func(*it);
+  }
+
+  std::shared_ptr<memo_cache> cache;
+  std::shared_ptr<std::vector<value_type> const> bulk;
 };
 
+/*
+ * fuses a transform of a transform into a single TransformFactor over the
+ * inner factor's container, so each step advances one iterator and stores one
+ * value however many transforms are stacked.  The inner factor's memoized and
+ * bulk results are not kept; wrap it with TransformFactor instead when its
+ * transform is expensive
+ */
+template <class Inner, class Container, class Outer>
+TransformFactor<ComposedTransform<Inner, std::decay_t<Outer>>, Container>
+compose(TransformFactor<Inner, Container> const& inner, Outer&& outer)
+{
+  return { inner, std::forward<Outer>(outer) };
+}
+
 } // namespace ParameterSweep
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+#include "type_traits.hpp"
+
+namespace ParameterSweep {
+
+/*
+ * A random access copy of the levels of a container whose iterators are not
+ * random access, such as std::set or std::list, so that looking up a level
+ * does not walk the container.  Containers that are already random access
+ * are not copied.
+ */
+template <class Container, bool = is_random_access_v<Container>>
+class LevelIndex
+{
+public:
+  LevelIndex() = default;
+  explicit LevelIndex(Container const&) {}
+
+  bool empty() const { return true; }
+  void clear() {}
+};
+
+template <class Container>
+class LevelIndex<Container, false>
+{
+public:
+  using value_type = typename Container::value_type;
+
+  LevelIndex() = default;
+  explicit LevelIndex(Container const& container)
+    : levels(std::begin(container), std::end(container))
+  {}
+
+  bool empty() const { return levels.empty(); }
+  void clear()
+  {
+    levels.clear();
+    levels.shrink_to_fit();
+  }
+
+  value_type const& operator[](size_t index) const { return levels[index]; }
+
+private:
+  std::vector<value_type> levels;
+};
+
+} // namespace ParameterSweep
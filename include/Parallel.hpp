@@ -0,0 +1,187 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ParameterSweep {
+
+struct ParallelOptions
+{
+  // number of worker threads, 0 uses std::thread::hardware_concurrency()
+  size_t threads = 0;
+  // number of consecutive points a worker claims at a time
+  size_t chunk_size = 1;
+};
+
+namespace detail {
+
+/*
+ * the range of ids a worker has not yet started; the owner takes chunks from
+ * the front, and idle workers steal the back half
+ */
+struct alignas(64) WorkRange
+{
+  std::mutex lock;
+  size_t first = 0;
+  size_t last = 0;
+
+  bool take(size_t chunk_size, size_t& chunk_first, size_t& chunk_last)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (first == last) {
+      return false;
+    }
+    chunk_first = first;
+    chunk_last = std::min(last, first + chunk_size);
+    first = chunk_last;
+    return true;
+  }
+
+  bool steal(size_t& stolen_first, size_t& stolen_last)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if (first == last) {
+      return false;
+    }
+    size_t mid = first + (last - first) / 2;
+    stolen_first = mid;
+    stolen_last = last;
+    last = mid;
+    return stolen_first != stolen_last;
+  }
+
+  void assign(size_t new_first, size_t new_last)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    first = new_first;
+    last = new_last;
+  }
+};
+
+/*
+ * calls visit with an iterator to every point of sweep using a pool of threads
+ */
+template <class Sweep, class Visit>
+void
+parallel_visit(Sweep const& sweep, Visit&& visit, ParallelOptions const& options)
+{
+  size_t const size = std::size(sweep);
+  size_t threads = options.threads;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::max<size_t>(1, std::min(threads, size));
+  size_t const chunk_size = std::max<size_t>(1, options.chunk_size);
+
+  std::vector<detail::WorkRange> ranges(threads);
+  for (size_t w = 0; w < threads; ++w) {
+    ranges[w].first = size * w / threads;
+    ranges[w].last = size * (w + 1) / threads;
+  }
+
+  std::atomic<bool> failed{ false };
+  std::exception_ptr error;
+  std::mutex error_lock;
+
+  using difference_type = typename std::iterator_traits<decltype(
+    std::begin(sweep))>::difference_type;
+  auto worker = [&](size_t w) {
+    auto it = std::begin(sweep);
+    size_t position = 0;
+    try {
+      while (!failed) {
+        size_t first, last;
+        if (!ranges[w].take(chunk_size, first, last)) {
+          bool found = false;
+          for (size_t v = 1; v < threads && !found; ++v) {
+            found = ranges[(w + v) % threads].steal(first, last);
+          }
+          if (!found) {
+            return;
+          }
+          ranges[w].assign(first, last);
+          continue;
+        }
+
+        // step the current iterator when the chunk continues from it, and
+        // only seek for the first, stolen, or non-adjacent chunks
+        if (first == position + 1) {
+          ++it;
+          ++position;
+        } else if (first != position) {
+          it += static_cast<difference_type>(first) -
+                static_cast<difference_type>(position);
+          position = first;
+        }
+        for (;;) {
+          visit(it);
+          if (position + 1 == last || failed) {
+            break;
+          }
+          ++it;
+          ++position;
+        }
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> guard(error_lock);
+      if (!error) {
+        error = std::current_exception();
+      }
+      failed = true;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t w = 1; w < threads; ++w) {
+    pool.emplace_back(worker, w);
+  }
+  worker(0);
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+} // namespace detail
+
+/*
+ * calls func with the value of every point of sweep using a pool of threads
+ *
+ * The ids are split evenly between the workers which then steal from each
+ * other when they run out so that points with uneven runtimes keep every
+ * thread busy.  The first exception thrown by func stops the sweep and is
+ * rethrown to the caller.
+ */
+template <class Sweep, class Func>
+void
+parallel_for_each(Sweep const& sweep, Func&& func,
+                  ParallelOptions const& options = {})
+{
+  detail::parallel_visit(
+    sweep, [&func](auto const& it) { func(*it); }, options);
+}
+
+/*
+ * like parallel_for_each, but calls func with the iterator to each point so
+ * that it can also use the id and any other state the iterator carries
+ */
+template <class Sweep, class Func>
+void
+parallel_for_each_iterator(Sweep const& sweep, Func&& func,
+                           ParallelOptions const& options = {})
+{
+  detail::parallel_visit(
+    sweep, [&func](auto const& it) { func(it); }, options);
+}
+
+} // namespace ParameterSweep
@@ -3,3 +3,5 @@
 #include <Distributions.hpp>
 #include <Factor.hpp>
 #include <Helpers.hpp>
+#include <Parallel.hpp>
+#include <Setup.hpp>
@@ -0,0 +1,183 @@
+#pragma once
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+
+/*
+ * A seeded pseudo-random permutation of [0, size) for any size
+ *
+ * Indices are shuffled by a balanced Feistel network over the smallest even
+ * number of bits that covers size.  Outputs that fall outside of [0, size)
+ * are fed back in (cycle walking) until they land inside, which takes fewer
+ * than 4 rounds of the network on average.  Both directions are computed
+ * directly, so nothing is stored no matter how large size is.
+ */
+class FeistelPermutation
+{
+public:
+  static constexpr size_t rounds = 6;
+
+  FeistelPermutation(size_t size, std::uint64_t seed = 0)
+    : n(size)
+    , half_bits(1)
+    , seed(seed)
+  {
+    while (half_bits < 32 && (std::uint64_t{ 1 } << (2 * half_bits)) < n) {
+      ++half_bits;
+    }
+    half_mask = (std::uint64_t{ 1 } << half_bits) - 1;
+
+    std::uint64_t state = seed;
+    for (auto& key : keys) {
+      key = splitmix64(state);
+    }
+  }
+
+  size_t size() const { return n; }
+  std::uint64_t get_seed() const { return seed; }
+
+  // the position i is moved to
+  size_t operator()(size_t i) const
+  {
+    assert(i < n && "index out of range");
+    std::uint64_t x = i;
+    do {
+      x = encrypt(x);
+    } while (x >= n);
+    return static_cast<size_t>(x);
+  }
+
+  // the position that is moved to i
+  size_t inverse(size_t i) const
+  {
+    assert(i < n && "index out of range");
+    std::uint64_t x = i;
+    do {
+      x = decrypt(x);
+    } while (x >= n);
+    return static_cast<size_t>(x);
+  }
+
+private:
+  static std::uint64_t splitmix64(std::uint64_t& state)
+  {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  std::uint64_t round_function(std::uint64_t half, std::uint64_t key) const
+  {
+    std::uint64_t z = half ^ key;
+    z = (z ^ (z >> 33)) * 0xFF51AFD7ED558CCDull;
+    z = (z ^ (z >> 33)) * 0xC4CEB9FE1A85EC53ull;
+    return (z ^ (z >> 33)) & half_mask;
+  }
+
+  std::uint64_t encrypt(std::uint64_t x) const
+  {
+    std::uint64_t left = x >> half_bits;
+    std::uint64_t right = x & half_mask;
+    for (size_t r = 0; r < rounds; ++r) {
+      std::uint64_t next = left ^ round_function(right, keys[r]);
+      left = right;
+      right = next;
+    }
+    return (left << half_bits) | right;
+  }
+
+  std::uint64_t decrypt(std::uint64_t x) const
+  {
+    std::uint64_t left = x >> half_bits;
+    std::uint64_t right = x & half_mask;
+    for (size_t r = rounds; r-- > 0;) {
+      std::uint64_t previous = right ^ round_function(left, keys[r]);
+      right = left;
+      left = previous;
+    }
+    return (left << half_bits) | right;
+  }
+
+  size_t n;
+  unsigned half_bits;
+  std::uint64_t half_mask;
+  std::uint64_t seed;
+  std::array<std::uint64_t, rounds> keys;
+};
+
+/*
+ * The permutation i -> (A + B * i) % size
+ *
+ * A and B must be co-prime with size, and with each other
+ */
+template <size_t A, size_t B>
+class AffinePermutation
+{
+public:
+  static_assert(std::lcm(A, B) == A * B, "A and B must be co-prime");
+
+  AffinePermutation(size_t size)
+    : n(size)
+    , b_inverse(size == 0 ? 0 : modular_inverse(B % size, size))
+  {
+    assert(std::lcm(A, size) == A * size);
+    assert(std::lcm(B, size) == B * size);
+  }
+
+  size_t size() const { return n; }
+
+  size_t operator()(size_t i) const { return (A + (B * i)) % n; }
+
+  size_t inverse(size_t i) const
+  {
+    // (i - A) * B^-1 without underflowing
+    size_t shifted = (i + n - (A % n)) % n;
+    return multiply_mod(shifted, b_inverse, n);
+  }
+
+private:
+  // a * b % n without overflowing
+  static size_t multiply_mod(size_t a, size_t b, size_t n)
+  {
+    size_t result = 0;
+    a %= n;
+    while (b != 0) {
+      if (b & 1) {
+        result = (result >= n - a) ? result - (n - a) : result + a;
+      }
+      a = (a >= n - a) ? a - (n - a) : a + a;
+      b >>= 1;
+    }
+    return result;
+  }
+
+  static size_t modular_inverse(size_t b, size_t n)
+  {
+    if (n <= 1) {
+      return 0;
+    }
+    // extended Euclid, tracking the coefficient of b
+    std::int64_t t = 0, new_t = 1;
+    std::int64_t r = static_cast<std::int64_t>(n),
+                 new_r = static_cast<std::int64_t>(b);
+    while (new_r != 0) {
+      std::int64_t quotient = r / new_r;
+      std::int64_t tmp = t - quotient * new_t;
+      t = new_t;
+      new_t = tmp;
+      tmp = r - quotient * new_r;
+      r = new_r;
+      new_r = tmp;
+    }
+    if (t < 0) {
+      t += static_cast<std::int64_t>(n);
+    }
+    return static_cast<size_t>(t);
+  }
+
+  size_t n;
+  size_t b_inverse;
+};
@@ -4,21 +4,29 @@
 #include<iterator>
 #include <numeric>
 #include <cassert>
-
-template <class T, size_t A, size_t B>
-class RandomOrder 
+#include <utility>
+#include "Permutation.hpp"
+#include "type_traits.hpp"
+
+/*
+ * visits the elements of container in the order given by a Permutation of
+ * [0, size); the remaining arguments of the constructor are passed to the
+ * Permutation after the size
+ */
+template <class T, class Permutation>
+class PermutedOrder
 {
 
 	public:
-		RandomOrder(T container): container(container)
+		template <class... Args>
+		PermutedOrder(T container, Args&&... args):
+			container(container),
+			permutation(std::size(this->container), std::forward<Args>(args)...)
 	{
-		auto size = std::size(container);
-		assert(std::lcm(A,size) ==A * size);
-		assert(std::lcm(B,size) == B * size);
-		static_assert(std::lcm(A,B) == A*B, "A and B must be co-prime");
 	}
 
 	using params_type = size_t;
+	static constexpr size_t parameter_arity = parameter_arity_v<T>;
 	class iterator
 	{
 			using iterator_ = typename T::iterator;
@@ -29,8 +37,8 @@ class RandomOrder
 			using difference_type = std::ptrdiff_t;
 			using iterator_category = std::random_access_iterator_tag;
 
-			iterator();
-			iterator(RandomOrder const* ptr, bool is_end=false):
+			iterator(): ptr(nullptr), index(0), value() {}
+			iterator(PermutedOrder const* ptr, bool is_end=false):
 				ptr(ptr),
 				index(is_end?ptr->size():0),
 				value()
@@ -57,6 +65,7 @@ class RandomOrder
 			}
 			iterator& operator--() {
 				index--;
+				update();
 				return *this;
 			}
 			iterator operator--(int) {
@@ -91,7 +100,7 @@ class RandomOrder
 				return *tmp;
 			}
 
-			difference_type operator-(iterator const& rhs) {
+			difference_type operator-(iterator const& rhs) const {
 				return index - rhs.index;
 			}
 
@@ -118,20 +127,29 @@ class RandomOrder
 				return (ptr->first()+mapped_index()).get_parameters();
 			}
 
+			//the position of this element in the permuted order
 			auto get_id() const {
 				return index;
 			}
 
+			//the id of this element in the underlying container
+			size_t get_mapped_id() const {
+				return ptr->id_at(index);
+			}
+
 		private:
 
 				size_t mapped_index() const {
-				return (A + (B * index)) % ptr->size();
+				return ptr->id_at(index);
 				}
 
 			void update() {
-				value = *std::next(ptr->first(), mapped_index());
+				//the end has no element to map to
+				if (index < ptr->size()) {
+					value = *std::next(ptr->first(), mapped_index());
+				}
 			}
-		RandomOrder const* ptr;
+		PermutedOrder const* ptr;
 		size_t index;
 		value_type value;
 	};
@@ -155,8 +173,22 @@ class RandomOrder
 
 
 	auto get_parameters(size_t i) const {
-		auto it = std::advance(begin(),i);
-		return it.get_parameters();
+		return at(i).get_parameters();
+	}
+
+	//an iterator to position of the permuted order, used to resume a sweep
+	iterator at(size_t position) const {
+		return begin() + static_cast<typename iterator::difference_type>(position);
+	}
+
+	//the id in the underlying container visited at position
+	size_t id_at(size_t position) const {
+		return permutation(position);
+	}
+
+	//the position at which the id in the underlying container is visited
+	size_t position_of(size_t id) const {
+		return permutation.inverse(id);
 	}
 
 	private:
@@ -167,8 +199,17 @@ class RandomOrder
 	
 	
 		T container;
+		Permutation permutation;
 };
 
+//visits container in the order i -> (A + B*i) % size
+template <class T, size_t A, size_t B>
+using RandomOrder = PermutedOrder<T, AffinePermutation<A, B>>;
+
+//visits container in a seeded pseudo-random order that works for any size
+template <class T>
+using ShuffleOrder = PermutedOrder<T, FeistelPermutation>;
+
 //the choice of 223 and 227 is arbitrary, they just need to be co-prime
 template <class T>
 using RandomOrderA = RandomOrder<T,223,227>;
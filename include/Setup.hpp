@@ -0,0 +1,327 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <future>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace ParameterSweep {
+
+/*
+ * marks a factor that has no setup in with_setup
+ */
+struct NoSetup
+{};
+
+namespace detail {
+
+template <class Setup, class Level>
+struct setup_product
+{
+  using type = std::decay_t<std::invoke_result_t<Setup const&, Level const&>>;
+};
+
+template <class Level>
+struct setup_product<NoSetup, Level>
+{
+  using type = NoSetup;
+};
+
+/*
+ * the products of one factor's setup keyed by level index, evicting the
+ * least recently used product once more than capacity are kept
+ *
+ * setup runs outside of the lock; threads that need a product that is still
+ * being set up wait on its future, so only threads after the same level wait
+ * for each other
+ */
+template <class Product>
+class ProductCache
+{
+public:
+  using pointer = std::shared_ptr<Product const>;
+
+  template <class Setup, class Level>
+  pointer get(size_t index, size_t capacity, Setup const& setup,
+              Level const& level)
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    auto found = positions.find(index);
+    if (found != positions.end()) {
+      recent.splice(recent.begin(), recent, found->second);
+      auto product = found->second->product;
+      guard.unlock();
+      return product.get();
+    }
+
+    std::promise<pointer> promise;
+    auto product = promise.get_future().share();
+    size_t const serial = next_serial++;
+    recent.push_front(entry{ index, serial, product });
+    positions[index] = recent.begin();
+    // evicted products are released after unlocking so teardown runs unlocked
+    std::list<entry> evicted;
+    while (recent.size() > capacity) {
+      positions.erase(recent.back().index);
+      evicted.splice(evicted.begin(), recent, std::prev(recent.end()));
+    }
+    guard.unlock();
+
+    try {
+      promise.set_value(std::make_shared<Product const>(setup(level)));
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+      forget(index, serial);
+    }
+    return product.get();
+  }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    recent.clear();
+    positions.clear();
+  }
+
+private:
+  struct entry
+  {
+    size_t index;
+    size_t serial;
+    std::shared_future<pointer> product;
+  };
+
+  // drops a failed setup so that the next visit of the level tries again
+  void forget(size_t index, size_t serial)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto found = positions.find(index);
+    if (found != positions.end() && found->second->serial == serial) {
+      recent.erase(found->second);
+      positions.erase(found);
+    }
+  }
+
+  std::mutex lock;
+  size_t next_serial = 0;
+  std::list<entry> recent;
+  std::unordered_map<size_t, typename std::list<entry>::iterator> positions;
+};
+
+} // namespace detail
+
+/*
+ * A view of a Builder that runs a setup for each factor whenever its level
+ * changes and keeps the products next to the values
+ *
+ * setup(level) is only called for the factors that changed() between
+ * consecutive points, and its result is reused from a cache keyed by level
+ * index while it is among the cache_size most recently used products of the
+ * factor.  Products are released, running any teardown in their destructor,
+ * once they are evicted and no iterator refers to them.  The cache is shared
+ * by every iterator of the view and is safe to use from multiple threads.
+ */
+template <class Sweep, class... Setups>
+class SetupSweep
+{
+  using base_iterator = typename Sweep::iterator;
+  using value_tuple = typename Sweep::value_type;
+  static_assert(sizeof...(Setups) == std::tuple_size<value_tuple>::value,
+                "with_setup requires one setup or NoSetup per factor");
+
+  template <size_t I>
+  using level_type = std::tuple_element_t<I, value_tuple>;
+  template <size_t I>
+  using setup_type = std::tuple_element_t<I, std::tuple<Setups...>>;
+
+  template <class Is>
+  struct product_types;
+  template <size_t... Is>
+  struct product_types<std::index_sequence<Is...>>
+  {
+    using type = std::tuple<
+      typename detail::setup_product<setup_type<Is>, level_type<Is>>::type...>;
+    using pointers = std::tuple<typename detail::ProductCache<
+      typename detail::setup_product<setup_type<Is>,
+                                     level_type<Is>>::type>::pointer...>;
+    using caches = std::tuple<detail::ProductCache<
+      typename detail::setup_product<setup_type<Is>, level_type<Is>>::type>...>;
+  };
+  using product_info = product_types<std::index_sequence_for<Setups...>>;
+
+public:
+  using products_type = typename product_info::type;
+  template <size_t I>
+  using product_type = std::tuple_element_t<I, products_type>;
+
+  SetupSweep(Sweep const& sweep, Setups... setups)
+    : sweep(&sweep)
+    , setups(std::move(setups)...)
+    , cache_size(1)
+    , caches(std::make_unique<cache_tuple>())
+  {}
+
+  class iterator
+  {
+  public:
+    using difference_type = std::ptrdiff_t;
+    using value_type = typename base_iterator::value_type;
+    using reference = typename base_iterator::const_reference;
+    using pointer = value_type const*;
+    using iterator_category = std::random_access_iterator_tag;
+
+    iterator()
+      : view(nullptr)
+      , base()
+      , products()
+    {}
+    iterator(SetupSweep const* view, base_iterator base)
+      : view(view)
+      , base(base)
+      , products()
+    {
+      refresh();
+    }
+
+    reference operator*() const { return *base; }
+    pointer operator->() const { return &*base; }
+
+    // the product of factor I's setup at the current point
+    template <size_t I>
+    product_type<I> const& get_product() const
+    {
+      static_assert(!std::is_same<setup_type<I>, NoSetup>::value,
+                    "factor I has no setup");
+      return *std::get<I>(products);
+    }
+
+    iterator& operator++()
+    {
+      ++base;
+      refresh();
+      return *this;
+    }
+    iterator operator++(int)
+    {
+      iterator tmp = *this;
+      ++(*this);
+      return tmp;
+    }
+    iterator& operator--() { return *this -= 1; }
+    iterator operator--(int)
+    {
+      iterator tmp = *this;
+      --(*this);
+      return tmp;
+    }
+    iterator& operator+=(difference_type n)
+    {
+      base += n;
+      refresh();
+      return *this;
+    }
+    iterator& operator-=(difference_type n) { return *this += (-n); }
+    iterator operator+(difference_type n) const
+    {
+      iterator tmp = *this;
+      tmp += n;
+      return tmp;
+    }
+    iterator operator-(difference_type n) const { return *this + (-n); }
+    difference_type operator-(iterator const& it) const
+    {
+      return base - it.base;
+    }
+
+    bool operator==(iterator const& it) const { return base == it.base; }
+    bool operator!=(iterator const& it) const { return base != it.base; }
+    bool operator<(iterator const& it) const { return base < it.base; }
+    bool operator>(iterator const& it) const { return base > it.base; }
+    bool operator<=(iterator const& it) const { return base <= it.base; }
+    bool operator>=(iterator const& it) const { return base >= it.base; }
+
+    base_iterator const& get_base() const { return base; }
+    auto get_id() const { return base.get_id(); }
+    auto get_indices() const { return base.get_indices(); }
+    auto const& changed() const { return base.changed(); }
+    auto get_parameters() const { return base.get_parameters(); }
+
+  private:
+    void refresh() { refresh(std::index_sequence_for<Setups...>{}); }
+
+    template <size_t... Is>
+    void refresh(std::index_sequence<Is...>)
+    {
+      auto const& changes = base.changed();
+      ((changes[Is] ? load<Is>() : void()), ...);
+    }
+
+    template <size_t I>
+    void load()
+    {
+      if constexpr (!std::is_same<setup_type<I>, NoSetup>::value) {
+        std::get<I>(products) = view->template get_product<I>(
+          base.get_indices()[I], std::get<I>(*base));
+      }
+    }
+
+    SetupSweep const* view;
+    base_iterator base;
+    typename product_info::pointers products;
+  };
+
+  iterator begin() const { return { this, std::begin(*sweep) }; }
+  iterator end() const { return { this, std::end(*sweep) }; }
+  size_t size() const { return std::size(*sweep); }
+
+  /*
+   * the number of products kept for each factor; 1 keeps only the current
+   * product, which suffices when a factor's levels are visited in runs
+   */
+  SetupSweep& set_cache_size(size_t cache_size)
+  {
+    this->cache_size = std::max<size_t>(1, cache_size);
+    clear_cache();
+    return *this;
+  }
+
+  void clear_cache()
+  {
+    std::apply([](auto&... cache) { (cache.clear(), ...); }, *caches);
+  }
+
+private:
+  template <size_t I>
+  auto get_product(size_t index, level_type<I> const& level) const
+  {
+    return std::get<I>(*caches).get(index, cache_size, std::get<I>(setups),
+                                    level);
+  }
+
+  using cache_tuple = typename product_info::caches;
+
+  Sweep const* sweep;
+  std::tuple<Setups...> setups;
+  size_t cache_size;
+  std::unique_ptr<cache_tuple> caches;
+};
+
+/*
+ * runs setups[i](level) whenever the level of factor i changes while
+ * iterating over sweep; pass NoSetup for factors that need no setup
+ */
+template <class Sweep, class... Setups>
+SetupSweep<Sweep, Setups...>
+with_setup(Sweep const& sweep, Setups... setups)
+{
+  return SetupSweep<Sweep, Setups...>(sweep, std::move(setups)...);
+}
+
+} // namespace ParameterSweep
@@ -2,6 +2,8 @@
 #include <algorithm>
 #include <array>
 #include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace {
 template <class Func, class Tuple, std::size_t... Is>
@@ -40,20 +42,43 @@ array_to_tuple_impl(Array const& array, std::index_sequence<Is...>)
   return std::make_tuple(array[Is]...);
 }
 
-template <class Type, class Func>
+/*
+ * dispatches to the element at a runtime index through a table of function
+ * pointers generated at compile time rather than testing every element
+ */
+template <class Func, class Tuple, std::size_t... Is>
 void
-do_apply(size_t is, size_t idx, Func&& func, Type&& tuple_element)
+apply_to_elm_impl(Func&& func, Tuple&& t, std::size_t index,
+                  std::index_sequence<Is...>)
 {
-  if (is == idx)
-    std::forward<Func>(func)(std::forward<Type>(tuple_element));
+  if constexpr (sizeof...(Is) != 0) {
+    using func_type = std::remove_reference_t<Func>;
+    using tuple_type = std::remove_reference_t<Tuple>;
+    using entry_type = void (*)(func_type&, tuple_type&);
+    static constexpr entry_type table[] = { [](func_type& func,
+                                               tuple_type& t) {
+      func(std::get<Is>(t));
+    }... };
+    if (index < sizeof...(Is)) {
+      table[index](func, t);
+    }
+  }
 }
 
-template <class Func, class Tuple, std::size_t... Is>
+template <class Func, std::size_t... Is>
 void
-apply_to_elm_impl(Func&& func, Tuple&& t, std::size_t index,
-                  std::index_sequence<Is...>)
+visit_index_impl(Func&& func, std::size_t index, std::index_sequence<Is...>)
 {
-  (do_apply(Is, index, std::forward<Func>(func), std::get<Is>(t)), ...);
+  if constexpr (sizeof...(Is) != 0) {
+    using func_type = std::remove_reference_t<Func>;
+    using entry_type = void (*)(func_type&);
+    static constexpr entry_type table[] = { [](func_type& func) {
+      func(std::integral_constant<std::size_t, Is>{});
+    }... };
+    if (index < sizeof...(Is)) {
+      table[index](func);
+    }
+  }
 }
 
 } // namespace
@@ -100,6 +125,17 @@ apply_to_elm(Func func, std::tuple<Types...> const& t, size_t index)
   apply_to_elm_impl(func, t, index, std::index_sequence_for<Types...>{});
 }
 
+/*
+ * calls func with std::integral_constant<std::size_t, index> for an index
+ * known only at runtime
+ */
+template <std::size_t N, class Func>
+void
+visit_index(Func&& func, std::size_t index)
+{
+  visit_index_impl(func, index, std::make_index_sequence<N>{});
+}
+
 template <class Type, class... Types>
 void
 get_runtime(std::tuple<Types...> const& t, size_t index, Type& elm)
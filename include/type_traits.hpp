@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
 #include <type_traits>
 
 template <class T>
@@ -35,3 +38,143 @@ public:
 
 template <class T>
 constexpr bool is_builder_it_v = is_builder_it<T>::value;
+
+/*
+ * detects containers whose const operator[] returns a reference into their
+ * storage, so that levels can be referred to without copying them
+ */
+template <class T, class = void>
+struct has_stable_subscript : std::false_type
+{};
+
+template <class T>
+struct has_stable_subscript<
+  T, std::enable_if_t<std::is_lvalue_reference_v<decltype(
+       std::declval<T const&>()[std::declval<std::size_t>()])>>>
+  : std::true_type
+{};
+
+template <class T>
+constexpr bool has_stable_subscript_v = has_stable_subscript<T>::value;
+
+/*
+ * the type used to refer to a level of a factor without copying it when
+ * possible
+ */
+template <class T>
+using level_reference_t =
+  std::conditional_t<has_stable_subscript_v<T>,
+                     typename T::value_type const&, typename T::value_type>;
+
+/*
+ * detects factors that report their own parameters, either directly or
+ * through their iterators, and so must declare a parameter_arity
+ */
+template <class T, class = void>
+struct has_builder_iterator : std::false_type
+{};
+
+template <class T>
+struct has_builder_iterator<
+  T, std::void_t<decltype(std::begin(std::declval<T const&>()))>>
+  : is_builder_it<decltype(std::begin(std::declval<T const&>()))>
+{};
+
+template <class T>
+constexpr bool is_builder_like_v =
+  is_builder_v<T> || has_builder_iterator<T>::value;
+
+/*
+ * the number of entries a factor contributes to get_parameters(); factors
+ * that do not declare a parameter_arity contribute only their level
+ */
+template <class T, class = void>
+struct parameter_arity : std::integral_constant<std::size_t, 1>
+{
+  static_assert(!is_builder_like_v<T>,
+                "factors with their own parameters must declare how many they "
+                "write with a static parameter_arity");
+};
+
+template <class T>
+struct parameter_arity<T, std::void_t<decltype(T::parameter_arity)>>
+  : std::integral_constant<std::size_t, T::parameter_arity>
+{};
+
+template <class T>
+constexpr std::size_t parameter_arity_v = parameter_arity<T>::value;
+
+template <class T, class = void>
+struct has_write_parameters : std::false_type
+{};
+
+template <class T>
+struct has_write_parameters<
+  T, std::void_t<decltype(std::declval<T const&>().write_parameters(
+       std::declval<std::size_t>(), std::declval<std::size_t*>()))>>
+  : std::true_type
+{};
+
+template <class T>
+constexpr bool has_write_parameters_v = has_write_parameters<T>::value;
+
+/*
+ * writes the parameters of level index of factor to out, returning the end
+ * of what was written
+ */
+template <class T>
+std::size_t*
+write_parameters_of(T const& factor, std::size_t index, std::size_t* out)
+{
+  if constexpr (has_write_parameters_v<T>) {
+    return factor.write_parameters(index, out);
+  } else if constexpr (is_builder_v<T>) {
+    auto params = factor.get_parameters(index);
+    return std::copy(std::begin(params), std::end(params), out);
+  } else {
+    *out = index;
+    return out + 1;
+  }
+}
+
+/*
+ * detects containers whose iterators support constant time random access
+ */
+template <class T>
+constexpr bool is_random_access_v = std::is_base_of_v<
+  std::random_access_iterator_tag,
+  typename std::iterator_traits<decltype(
+    std::begin(std::declval<T const&>()))>::iterator_category>;
+
+/*
+ * detects generators with a batch generate(out, count) member
+ */
+template <class T, class = void>
+struct has_generate : std::false_type
+{};
+
+template <class T>
+struct has_generate<
+  T, std::void_t<decltype(std::declval<T&>().generate(
+       std::declval<typename T::result_type*>(), std::size_t{}))>>
+  : std::true_type
+{};
+
+template <class T>
+constexpr bool has_generate_v = has_generate<T>::value;
+
+/*
+ * detects types that can be ordered with operator<
+ */
+template <class T, class = void>
+struct is_less_than_comparable : std::false_type
+{};
+
+template <class T>
+struct is_less_than_comparable<
+  T, std::void_t<decltype(std::declval<T const&>() < std::declval<T const&>())>>
+  : std::true_type
+{};
+
+template <class T>
+constexpr bool is_less_than_comparable_v = is_less_than_comparable<T>::value;
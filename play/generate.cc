@@ -0,0 +1,62 @@
+/*
+ * compares drawing random values one virtual call at a time with drawing
+ * them in batches through generate
+ */
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <Distributions.hpp>
+
+template <class Func>
+double
+time_per_value(size_t count, Func&& func)
+{
+	auto start = std::chrono::steady_clock::now();
+	func();
+	auto stop = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::nano> elapsed = stop - start;
+	return elapsed.count() / count;
+}
+
+template <class T>
+void
+compare(const char* name, RandomNumberGenerator<T>& gen, std::vector<T>& values)
+{
+	double single = time_per_value(values.size(), [&] {
+		for (auto& value : values) value = gen();
+	});
+	double batch = time_per_value(values.size(), [&] {
+		gen.generate(values.data(), values.size());
+	});
+	std::cout << name << " " << single << " " << batch << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t count = 1 << 24;
+	std::seed_seq seed;
+	std::vector<float> floats(count);
+	std::vector<int> ints(count);
+
+	std::cout << "distribution ns/value(single) ns/value(batch)" << std::endl;
+	auto uniform = make_dist(std::minstd_rand(seed), std::uniform_real_distribution<float>(0, 1));
+	compare("minstd_uniform_real", *uniform, floats);
+	auto normal = make_dist(std::minstd_rand(seed), std::normal_distribution<float>(0, 1));
+	compare("minstd_normal", *normal, floats);
+	auto mt_int = make_dist(std::mt19937(seed), std::uniform_int_distribution<int>(0, 100));
+	compare("mt19937_uniform_int", *mt_int, ints);
+	auto philox = make_dist(Philox4x32(), std::uniform_real_distribution<float>(0, 1));
+	compare("philox_uniform_real", *philox, floats);
+
+	std::vector<std::uint32_t> raw(count);
+	Philox4x32 engine;
+	double single = time_per_value(count, [&] {
+		for (auto& value : raw) value = engine();
+	});
+	double batch = time_per_value(count, [&] { engine.generate(raw.data(), count); });
+	std::cout << "philox_raw " << single << " " << batch << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,55 @@
+/*
+ * measures the cost of incrementing a Builder::iterator as the number of
+ * factors holding heavy values grows
+ */
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <ParameterSweep.hpp>
+
+template <size_t>
+using Levels = std::vector<std::string>;
+
+template <size_t... Is>
+double
+time_per_step(Levels<0> const& levels, std::index_sequence<Is...>)
+{
+	ParameterSweep::Builder<Levels<Is>...> builder((static_cast<void>(Is), levels)...);
+	size_t checksum = 0;
+	size_t steps = 0;
+	auto start = std::chrono::steady_clock::now();
+	// repeat small sweeps so that every case takes a similar number of steps
+	while (steps < (1 << 20)) {
+		for (auto const& value : builder) {
+			checksum += std::get<0>(value).size();
+			++steps;
+		}
+	}
+	auto stop = std::chrono::steady_clock::now();
+	std::chrono::duration<double, std::nano> elapsed = stop - start;
+	if (checksum == 0) std::cout << "unexpected checksum" << std::endl;
+	return elapsed.count() / steps;
+}
+
+int main(int argc, char *argv[])
+{
+	// long enough to defeat the small string optimization
+	Levels<0> levels = {
+		std::string(256, 'a'),
+		std::string(256, 'b'),
+		std::string(256, 'c'),
+		std::string(256, 'd'),
+	};
+	Levels<0> two_levels(levels.begin(), levels.begin() + 2);
+
+	std::cout << "factors ns/step" << std::endl;
+	std::cout << 2 << " " << time_per_step(levels, std::make_index_sequence<2>{}) << std::endl;
+	std::cout << 4 << " " << time_per_step(levels, std::make_index_sequence<4>{}) << std::endl;
+	std::cout << 8 << " " << time_per_step(levels, std::make_index_sequence<8>{}) << std::endl;
+	std::cout << 12 << " " << time_per_step(levels, std::make_index_sequence<12>{}) << std::endl;
+	std::cout << 16 << " " << time_per_step(two_levels, std::make_index_sequence<16>{}) << std::endl;
+
+	return 0;
+}
@@ -10,6 +10,8 @@ std::ostream& operator<<(std::ostream& out, Order const& order)
 			return out << "default";
 		case Order::Sorted:
 			return out << "sorted";
+		case Order::Gray:
+			return out << "gray";
 	}
 	return out;
 }
@@ -23,6 +25,22 @@ std::ostream& operator<<(std::ostream& out, Design const& design)
 			return out << "full factorial";
 		case Design::OneAtATime:
 			return out << "one at a time";
+		case Design::LatinHypercube:
+			return out << "latin hypercube";
+	}
+	return out;
+}
+
+std::ostream& operator<<(std::ostream& out, Sharding const& sharding)
+{
+	switch(sharding)
+	{
+		case Sharding::Blocked:
+			return out << "blocked";
+		case Sharding::Interleaved:
+			return out << "interleaved";
+		case Sharding::ReplicantBlocked:
+			return out << "replicant blocked";
 	}
 	return out;
 }
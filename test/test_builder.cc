@@ -3,6 +3,9 @@
 
 #include <gtest/gtest.h>
 #include <iterator>
+#include <list>
+#include <numeric>
+#include <set>
 #include <sstream>
 #include <string>
 #include <type_traits>
@@ -26,7 +29,8 @@ public:
   Builder<std::vector<int>, std::vector<float>> example = { i, f };
 
   static constexpr auto all_designs = { Design::FullFactorial,
-                                        Design::OneAtATime };
+                                        Design::OneAtATime,
+                                        Design::LatinHypercube };
   using example_type = Builder<std::vector<int>, std::vector<float>>;
   using iterator = example_type::iterator;
 };
@@ -60,6 +64,12 @@ TEST_F(ParameterSweepBuilder, IteratorPrimitives)
     auto i = ++std::begin(example);
     (void)i;
   }
+
+  // replicants of the same point are different positions
+  {
+    EXPECT_NE(std::begin(example), std::begin(example) + 1);
+    EXPECT_EQ(std::begin(example) + 1, ++std::begin(example));
+  }
 }
 
 TEST_F(ParameterSweepBuilder, DebugPrinting)
@@ -140,6 +150,17 @@ get_sizes(T& builder)
 
 } // namespace
 
+namespace {
+
+template <class... Ts>
+std::tuple<std::decay_t<Ts>...>
+value_type_of(std::tuple<Ts...> const& references)
+{
+  return references;
+}
+
+} // namespace
+
 TEST_F(ParameterSweepBuilder, SizeFullFactorial)
 {
   auto [count, unique_count] = get_sizes(example);
@@ -158,6 +179,36 @@ TEST_F(ParameterSweepBuilder, SizeOneAtATime)
   EXPECT_EQ((5 + 7 - 1) * 30, count);
 }
 
+TEST_F(ParameterSweepBuilder, SizeLatinHypercube)
+{
+  example.set_design(Design::LatinHypercube);
+  EXPECT_EQ(7 * 30, example.size());
+  example.set_samples(3);
+  auto [count, unique_count] = get_sizes(example);
+  EXPECT_EQ(3 * 30, example.size());
+  EXPECT_EQ(3, unique_count);
+  EXPECT_EQ(3 * 30, count);
+}
+
+TEST_F(ParameterSweepBuilder, SizeFollowsSettings)
+{
+  std::array<size_t, 2> expected_levels{ 7, 5 };
+  EXPECT_EQ(expected_levels, example.levels());
+
+  example.set_replicants(2);
+  EXPECT_EQ(7 * 5 * 2, example.size());
+  EXPECT_EQ(7 * 5 * 2, std::end(example) - std::begin(example));
+  EXPECT_EQ(std::end(example), std::begin(example) + (7 * 5 * 2));
+
+  example.set_design(Design::OneAtATime);
+  EXPECT_EQ((5 + 7 - 1) * 2, example.size());
+  EXPECT_EQ((5 + 7 - 1) * 2, std::end(example).get_id());
+
+  example.set_replicants(1);
+  EXPECT_EQ(5 + 7 - 1, example.size());
+  EXPECT_EQ(expected_levels, example.levels());
+}
+
 TEST_F(ParameterSweepBuilder, EmptySize)
 {
   for (auto const& design : all_designs) {
@@ -248,6 +299,459 @@ TEST_F(ParameterSweepBuilder, IncrementCountDown)
   }
 }
 
+TEST_F(ParameterSweepBuilder, RandomAccessMatchesIncrement)
+{
+  std::vector<int> single = { 42 };
+  Builder with_single(i, single, f);
+
+  for (auto const& design : all_designs) {
+    example.set_replicants(3).set_design(design);
+    with_single.set_replicants(2).set_design(design);
+
+    auto check = [](auto const& builder) {
+      auto incr = std::begin(builder);
+      size_t count = 0;
+      for (; incr != std::end(builder); ++incr, ++count) {
+        auto raccess = std::begin(builder) + count;
+        EXPECT_EQ(raccess, incr);
+        EXPECT_EQ(*raccess, *incr);
+        EXPECT_EQ(count, incr.get_id());
+        EXPECT_EQ(count, incr - std::begin(builder));
+        EXPECT_EQ(incr.get_parameters(), builder.get_parameters(count));
+        EXPECT_EQ(std::end(builder) - count, std::begin(builder) +
+                                               (builder.size() - count));
+      }
+      EXPECT_EQ(builder.size(), count);
+    };
+    check(example);
+    check(with_single);
+  }
+}
+
+TEST_F(ParameterSweepBuilder, OneAtATimeOrder)
+{
+  std::vector<int> a = { 1, 2, 3 };
+  std::vector<int> b = { 10 };
+  std::vector<int> c = { 100, 200 };
+  Builder builder(a, b, c);
+  builder.set_design(Design::OneAtATime);
+
+  std::vector<std::tuple<int, int, int>> expected = {
+    { 1, 10, 100 }, { 2, 10, 100 }, { 3, 10, 100 }, { 1, 10, 200 }
+  };
+  std::vector<std::tuple<int, int, int>> results(std::begin(builder),
+                                                 std::end(builder));
+  EXPECT_EQ(expected, results);
+  EXPECT_EQ(std::size(expected), builder.size());
+}
+
+TEST_F(ParameterSweepBuilder, SortedOrder)
+{
+  std::vector<int> a = { 3, 1, 2 };
+  std::list<std::string> b = { "b", "c", "a" };
+  std::vector<float> c = { 0.5, -1. };
+  Builder builder(a, b, c);
+  builder.set_replicants(2).set_order(Order::Sorted);
+
+  std::vector<std::tuple<int, std::string, float>> expected;
+  for (auto const& value : Builder(a, b, c)) {
+    expected.push_back(value);
+    expected.push_back(value);
+  }
+  std::sort(std::begin(expected), std::end(expected));
+
+  std::vector<std::tuple<int, std::string, float>> results(std::begin(builder),
+                                                           std::end(builder));
+  EXPECT_EQ(expected, results);
+  for (size_t id = 0; id < builder.size(); ++id) {
+    auto it = std::begin(builder) + id;
+    EXPECT_EQ(expected[id], *it);
+    EXPECT_EQ(id, it.get_id());
+  }
+
+  // parameters are still the positions of the levels in each factor
+  std::vector<size_t> first_parameters = { 1, 2, 1 };
+  EXPECT_EQ(first_parameters, std::begin(builder).get_parameters());
+  EXPECT_EQ(first_parameters, builder.get_parameters(1));
+
+  std::vector<int> as(builder.size());
+  std::vector<std::string> bs(builder.size());
+  std::vector<float> cs(builder.size());
+  builder.materialize(3, builder.size() - 3, as.data(), bs.data(), cs.data());
+  for (size_t j = 0; j + 3 < builder.size(); ++j) {
+    EXPECT_EQ(expected[j + 3], std::make_tuple(as[j], bs[j], cs[j]));
+  }
+
+  builder.set_replicants(1).set_design(Design::OneAtATime);
+  std::vector<std::tuple<int, std::string, float>> one_at_a_time = {
+    { 1, "a", -1. }, { 1, "a", 0.5 }, { 1, "b", -1. },
+    { 1, "c", -1. }, { 2, "a", -1. }, { 3, "a", -1. },
+  };
+  std::vector<std::tuple<int, std::string, float>> oat_results(
+    std::begin(builder), std::end(builder));
+  EXPECT_EQ(one_at_a_time, oat_results);
+
+  builder.set_order(Order::Default);
+  EXPECT_EQ(std::make_tuple(3, std::string("b"), 0.5f), *std::begin(builder));
+
+  struct unordered
+  {};
+  std::vector<unordered> levels(2);
+  Builder unsortable(a, levels);
+  EXPECT_THROW(unsortable.set_order(Order::Sorted), std::runtime_error);
+
+  // a later factor failing to sort leaves the earlier order in place
+  Builder unchanged(a, levels);
+  size_t id = 0;
+  for (auto it = std::begin(unsortable); it != std::end(unsortable);
+       ++it, ++id) {
+    EXPECT_EQ(unchanged.get_parameters(id), it.get_parameters());
+    EXPECT_EQ(a[it.get_indices()[0]], std::get<0>(*it));
+  }
+  EXPECT_EQ(unchanged.size(), id);
+  EXPECT_EQ(3, std::get<0>(*std::begin(unsortable)));
+}
+
+TEST_F(ParameterSweepBuilder, FactorChangeCost)
+{
+  std::vector<int> a = { 1, 2, 3 };
+  std::vector<int> b = { 10, 20 };
+  std::vector<int> c = { 100, 200 };
+  Builder builder(a, b, c);
+  builder.set_factor_change_cost({ 100., 1., 10. });
+
+  std::vector<std::tuple<int, int, int>> expected;
+  for (int i : a) {
+    for (int k : c) {
+      for (int j : b) {
+        expected.emplace_back(i, j, k);
+      }
+    }
+  }
+  std::vector<std::tuple<int, int, int>> results(std::begin(builder),
+                                                 std::end(builder));
+  EXPECT_EQ(expected, results);
+
+  std::array<size_t, 3> changes{};
+  size_t id = 0;
+  for (auto it = std::begin(builder); it != std::end(builder); ++it, ++id) {
+    for (size_t f = 0; f < changes.size(); ++f) {
+      changes[f] += it.changed()[f];
+    }
+    EXPECT_EQ(*it, *(std::begin(builder) + id));
+    EXPECT_EQ(it.get_parameters(), builder.get_parameters(id));
+  }
+  std::array<size_t, 3> expected_changes = { 3, 12, 6 };
+  EXPECT_EQ(expected_changes, changes);
+  std::vector<size_t> parameters = { 0, 1, 0 };
+  EXPECT_EQ(parameters, builder.get_parameters(1));
+
+  builder.set_design(Design::OneAtATime);
+  std::vector<std::tuple<int, int, int>> one_at_a_time = {
+    { 1, 10, 100 }, { 1, 20, 100 }, { 1, 10, 200 },
+    { 2, 10, 100 }, { 3, 10, 100 },
+  };
+  std::vector<std::tuple<int, int, int>> oat_results(std::begin(builder),
+                                                     std::end(builder));
+  EXPECT_EQ(one_at_a_time, oat_results);
+
+  // equal costs keep the declaration order
+  builder.set_design(Design::FullFactorial).set_factor_change_cost({});
+  EXPECT_EQ(std::make_tuple(2, 10, 100), *(std::begin(builder) + 1));
+}
+
+TEST_F(ParameterSweepBuilder, GrayOrder)
+{
+  std::vector<int> a = { 1, 2, 3 };
+  std::vector<int> b = { 10, 20 };
+  std::vector<int> c = { 100, 200, 300, 400 };
+  Builder builder(a, b, c);
+  builder.set_replicants(2).set_order(Order::Gray);
+
+  std::set<std::tuple<int, int, int>> visited;
+  auto previous = std::begin(builder);
+  size_t id = 0;
+  for (auto it = std::begin(builder); it != std::end(builder); ++it, ++id) {
+    EXPECT_EQ(*it, *(std::begin(builder) + id));
+    EXPECT_EQ(id, it.get_id());
+    EXPECT_EQ(it.get_parameters(), builder.get_parameters(id));
+    if (id % 2 == 0) {
+      EXPECT_TRUE(visited.insert(*it).second) << "visited twice";
+    }
+    if (id != 0 && id % 2 == 0) {
+      EXPECT_EQ(1, it.changed().count()) << "id=" << id;
+      size_t differences = (std::get<0>(*it) != std::get<0>(*previous)) +
+                           (std::get<1>(*it) != std::get<1>(*previous)) +
+                           (std::get<2>(*it) != std::get<2>(*previous));
+      EXPECT_EQ(1, differences) << "id=" << id;
+    }
+    previous = it;
+  }
+  EXPECT_EQ(24, visited.size());
+
+  std::vector<std::tuple<int, int, int>> first = {
+    { 1, 10, 100 }, { 2, 10, 100 }, { 3, 10, 100 },
+    { 3, 20, 100 }, { 2, 20, 100 }, { 1, 20, 100 },
+    { 1, 20, 200 }, { 2, 20, 200 },
+  };
+  builder.set_replicants(1);
+  std::vector<std::tuple<int, int, int>> results(std::begin(builder),
+                                                 std::begin(builder) + 8);
+  EXPECT_EQ(first, results);
+
+  std::vector<int> as(builder.size()), bs(builder.size()), cs(builder.size());
+  builder.materialize(5, builder.size() - 5, as.data(), bs.data(), cs.data());
+  auto it = std::begin(builder) + 5;
+  for (size_t j = 0; j + 5 < builder.size(); ++j, ++it) {
+    EXPECT_EQ(std::make_tuple(as[j], bs[j], cs[j]), *it);
+  }
+
+  std::stringstream ss;
+  ss << builder;
+  EXPECT_EQ("ParameterSweep replicants: 1, design: full factorial, order: "
+            "gray, factors: (3)",
+            ss.str());
+}
+
+TEST_F(ParameterSweepBuilder, LatinHypercube)
+{
+  std::vector<int> a(10), b(5), c(20);
+  std::iota(std::begin(a), std::end(a), 0);
+  std::iota(std::begin(b), std::end(b), 0);
+  std::iota(std::begin(c), std::end(c), 0);
+  Builder builder(a, b, c);
+  builder.set_design(Design::LatinHypercube).set_samples(10).set_seed(3);
+  ASSERT_EQ(10, builder.size());
+
+  std::vector<int> a_count(10), b_count(5), c_count(10);
+  size_t id = 0;
+  for (auto it = std::begin(builder); it != std::end(builder); ++it, ++id) {
+    auto const& [a_level, b_level, c_level] = *it;
+    a_count[a_level]++;
+    b_count[b_level]++;
+    // each sample lands in its own pair of c's levels
+    c_count[c_level / 2]++;
+    EXPECT_EQ(*it, *(std::begin(builder) + id));
+    EXPECT_EQ(it.get_parameters(), builder.get_parameters(id));
+  }
+  EXPECT_EQ(std::vector<int>(10, 1), a_count);
+  EXPECT_EQ(std::vector<int>(5, 2), b_count);
+  EXPECT_EQ(std::vector<int>(10, 1), c_count);
+
+  std::vector<std::tuple<int, int, int>> first(std::begin(builder),
+                                               std::end(builder));
+  builder.set_seed(4);
+  std::vector<std::tuple<int, int, int>> reseeded(std::begin(builder),
+                                                  std::end(builder));
+  EXPECT_NE(first, reseeded);
+  builder.set_seed(3);
+  std::vector<std::tuple<int, int, int>> again(std::begin(builder),
+                                               std::end(builder));
+  EXPECT_EQ(first, again);
+
+  // samples that repeat a point are still different positions
+  Builder small(std::vector<int>{ 1, 2 }, std::vector<int>{ 3, 4 });
+  small.set_design(Design::LatinHypercube).set_samples(8);
+  for (size_t i = 0; i < small.size(); ++i) {
+    for (size_t j = 0; j < small.size(); ++j) {
+      EXPECT_EQ(i == j, std::begin(small) + i == std::begin(small) + j);
+    }
+  }
+  size_t steps = 0;
+  for (auto it = std::begin(small); it != std::begin(small) + 3; ++it) {
+    ++steps;
+  }
+  EXPECT_EQ(3, steps);
+
+  // huge spaces are sampled without enumerating them
+  std::vector<int> wide(1000000);
+  Builder huge(wide, wide, wide, wide);
+  huge.set_design(Design::LatinHypercube).set_samples(1000);
+  EXPECT_EQ(1000, huge.size());
+  auto indices = (std::begin(huge) + 999).get_indices();
+  for (auto index : indices) {
+    EXPECT_LT(index, wide.size());
+  }
+
+  std::stringstream ss;
+  ss << builder;
+  EXPECT_EQ("ParameterSweep replicants: 1, design: latin hypercube, order: "
+            "default, factors: (3)",
+            ss.str());
+}
+
+TEST_F(ParameterSweepBuilder, Shards)
+{
+  example.set_replicants(3);
+  for (auto const& design : all_designs) {
+    example.set_design(design);
+    for (auto policy : { Sharding::Blocked, Sharding::Interleaved,
+                         Sharding::ReplicantBlocked }) {
+      for (size_t nranks = 1; nranks < 8; ++nranks) {
+        std::vector<int> visits(example.size());
+        size_t total = 0;
+        for (size_t rank = 0; rank < nranks; ++rank) {
+          auto shard = example.shard(rank, nranks, policy);
+          EXPECT_EQ(shard.size(),
+                    std::distance(std::begin(shard), std::end(shard)));
+          total += shard.size();
+
+          size_t count = 0;
+          for (auto it = std::begin(shard); it != std::end(shard);
+               ++it, ++count) {
+            auto id = it.get_id();
+            EXPECT_EQ(*(std::begin(example) + id), *it);
+            EXPECT_EQ(it, std::begin(shard) + count);
+            visits.at(id)++;
+            switch (policy) {
+              case Sharding::Interleaved:
+                EXPECT_EQ(rank, id % nranks);
+                break;
+              case Sharding::ReplicantBlocked:
+                if (count == 0) {
+                  EXPECT_EQ(0, id % 3) << "shards start with replicant 0";
+                }
+                break;
+              default:
+                break;
+            }
+          }
+          EXPECT_EQ(shard.size(), count);
+          if (policy == Sharding::ReplicantBlocked) {
+            EXPECT_EQ(0, shard.size() % 3) << "shards end with replicant 2";
+          }
+        }
+        EXPECT_EQ(example.size(), total) << policy << " " << nranks;
+        EXPECT_TRUE(std::all_of(std::begin(visits), std::end(visits),
+                                [](int visit) { return visit == 1; }))
+          << policy << " " << nranks;
+      }
+    }
+  }
+}
+
+TEST_F(ParameterSweepBuilder, Materialize)
+{
+  std::set<int> s = { 3, 1, 2 };
+  Builder builder(f, s, i);
+  for (auto const& design : all_designs) {
+    builder.set_design(design);
+    for (size_t replicants : { 1, 3 }) {
+      builder.set_replicants(replicants);
+      auto size = builder.size();
+      for (size_t start : { size_t{ 0 }, size_t{ 1 }, size_t{ 8 }, size / 2 }) {
+        for (size_t count : { size_t{ 1 }, size_t{ 7 }, size }) {
+          std::vector<float> fs(count);
+          std::vector<int> ss(count);
+          std::vector<int> is(count);
+          auto written = builder.materialize(start, count, fs.data(),
+                                             ss.data(), is.data());
+          EXPECT_EQ(start < size ? std::min(count, size - start) : 0,
+                    written);
+
+          auto it = std::begin(builder) + start;
+          for (size_t j = 0; j < written; ++j, ++it) {
+            EXPECT_EQ(std::make_tuple(fs[j], ss[j], is[j]), *it)
+              << design << " start=" << start << " j=" << j;
+          }
+        }
+      }
+    }
+  }
+  float unused_f;
+  int unused_s, unused_i;
+  EXPECT_EQ(0, builder.materialize(builder.size(), 1, &unused_f, &unused_s,
+                                   &unused_i));
+}
+
+TEST_F(ParameterSweepBuilder, IncrementTracksChanges)
+{
+  using changes = iterator::change_type;
+  example.set_replicants(2);
+  auto it = std::begin(example);
+  EXPECT_EQ(changes("11"), it.changed());
+  ++it;
+  EXPECT_EQ(changes("00"), it.changed()) << "only the replicant changed";
+  ++it;
+  EXPECT_EQ(changes("01"), it.changed());
+  it += 2 * 6 - 2;
+  EXPECT_EQ(changes("01"), it.changed()) << "seeking only reloads changes";
+  ++it;
+  ++it;
+  EXPECT_EQ(changes("11"), it.changed()) << "carry into the second factor";
+  EXPECT_EQ(std::make_tuple(1, 2.f), *it);
+
+  example.set_design(Design::OneAtATime).set_replicants(1);
+  it = std::begin(example) + 6;
+  ++it;
+  EXPECT_EQ(changes("11"), it.changed());
+  EXPECT_EQ(std::make_tuple(1, 2.f), *it);
+  ++it;
+  EXPECT_EQ(changes("10"), it.changed());
+  EXPECT_EQ(std::make_tuple(1, 3.f), *it);
+}
+
+TEST_F(ParameterSweepBuilder, SingleLevelFactorNeverChanges)
+{
+  Builder builder(std::vector<int>{ 1, 2 }, std::vector<int>{ 9 },
+                  std::vector<int>{ 3, 4, 5 });
+  builder.set_replicants(2);
+  for (auto const& order : { Order::Default, Order::Sorted }) {
+    builder.set_order(order);
+    auto it = std::begin(builder);
+    EXPECT_TRUE(it.changed()[1]);
+    for (++it; it != std::end(builder); ++it) {
+      EXPECT_FALSE(it.changed()[1]) << "id=" << it.get_id();
+    }
+    auto cursors = builder.cursors();
+    for (auto c = ++std::begin(cursors); c != std::end(cursors); ++c) {
+      EXPECT_FALSE(c.changed()[1]) << "id=" << c.get_id();
+    }
+  }
+}
+
+TEST_F(ParameterSweepBuilder, Cursors)
+{
+  using cursor = example_type::cursor;
+  static_assert(
+    std::is_same_v<std::tuple<int const&, float const&>, cursor::reference>,
+    "vectors are referred to without copying");
+  using generated_type = Builder<RangeFactor<int>, std::vector<int>>;
+  static_assert(std::is_same_v<std::tuple<int, int const&>,
+                               generated_type::cursor::reference>,
+                "generated levels are returned by value");
+
+  example.set_replicants(2);
+  for (auto const& design : all_designs) {
+    example.set_design(design);
+    auto cursors = example.cursors();
+    EXPECT_EQ(example.size(), cursors.size());
+
+    auto it = std::begin(example);
+    for (auto c = std::begin(cursors); c != std::end(cursors); ++c, ++it) {
+      EXPECT_EQ(*it, value_type_of(*c));
+      EXPECT_EQ(it.get_id(), c.get_id());
+      EXPECT_EQ(it.get_indices(), c.get_indices());
+      EXPECT_EQ(it.get_parameters(), c.get_parameters());
+      EXPECT_EQ(c, std::begin(cursors) + c.get_id());
+      auto const& levels = std::get<0>(example.get_factors());
+      EXPECT_EQ(&levels[c.get_indices()[0]], &c.get<0>());
+    }
+    EXPECT_EQ(std::end(example), it);
+
+    // a default constructed cursor acts as the end cursor
+    auto first = std::begin(cursors);
+    EXPECT_EQ(std::end(cursors), cursor{});
+    EXPECT_EQ(static_cast<cursor::difference_type>(example.size()),
+              cursor{} - first);
+    EXPECT_EQ(-static_cast<cursor::difference_type>(example.size()),
+              first - cursor{});
+    EXPECT_LT(first, cursor{});
+    EXPECT_FALSE(cursor{} < std::end(cursors));
+    EXPECT_EQ(0, cursor{} - cursor{});
+  }
+}
+
 TEST_F(ParameterSweepBuilder, toParametersSimple)
 {
   example.set_replicants(3);
@@ -283,3 +787,97 @@ TEST_F(ParameterSweepBuilder, toParametersFactor)
     EXPECT_EQ(expected, params);
   }
 }
+
+TEST_F(ParameterSweepBuilder, toParametersArray)
+{
+  std::vector<int> f_1 = { 1, 2, 3, 4 };
+  std::vector<int> f_2 = { 1, 2, 3 };
+  Factor factor{ f_1, f_2 };
+  TransformFactor trans(example, [](auto const& t) { return std::get<0>(t); });
+  Builder nested(factor, i, trans);
+  using nested_type = decltype(nested);
+
+  static_assert(example_type::parameter_arity == 2);
+  static_assert(decltype(factor)::parameter_arity == 3);
+  static_assert(decltype(trans)::parameter_arity == 2);
+  static_assert(nested_type::parameter_arity == 3 + 1 + 2);
+  static_assert(std::is_same_v<std::array<size_t, 6>,
+                               nested_type::parameters_type>);
+
+  size_t id = 0;
+  for (auto it = std::begin(nested); it != std::end(nested); ++it, ++id) {
+    auto expected = it.get_parameters();
+    auto array = it.get_parameter_array();
+    EXPECT_EQ(expected,
+              std::vector<size_t>(std::begin(array), std::end(array)));
+
+    nested_type::parameters_type written;
+    EXPECT_EQ(written.data() + written.size(),
+              nested.write_parameters(id, written.data()));
+    EXPECT_EQ(array, written);
+  }
+}
+
+TEST_F(ParameterSweepBuilder, toParametersBatch)
+{
+  Builder nested(i, example);
+  example.set_replicants(2);
+  for (auto const& design : all_designs) {
+    nested.set_design(design).set_replicants(3);
+    auto size = nested.size();
+    constexpr auto arity = decltype(nested)::parameter_arity;
+
+    std::vector<size_t> expected;
+    for (auto it = std::begin(nested); it != std::end(nested); ++it) {
+      auto params = it.get_parameters();
+      expected.insert(std::end(expected), std::begin(params), std::end(params));
+    }
+
+    EXPECT_EQ(expected, nested.get_parameters(0, size));
+    EXPECT_EQ(std::vector<size_t>(std::begin(expected) + 5 * arity,
+                                  std::begin(expected) + 9 * arity),
+              nested.get_parameters(5, 9));
+    EXPECT_EQ(std::vector<size_t>(std::end(expected) - arity,
+                                  std::end(expected)),
+              nested.get_parameters(size - 1, size + 10));
+    EXPECT_TRUE(nested.get_parameters(size, size + 1).empty());
+
+    std::vector<size_t> ids = { size - 1, 0, 7, 7, 3 };
+    std::vector<size_t> matrix(ids.size() * arity);
+    EXPECT_EQ(matrix.data() + matrix.size(),
+              nested.write_parameters(std::begin(ids), std::end(ids),
+                                      matrix.data()));
+    for (size_t row = 0; row < ids.size(); ++row) {
+      EXPECT_EQ(nested.get_parameters(ids[row]),
+                std::vector<size_t>(std::begin(matrix) + row * arity,
+                                    std::begin(matrix) + (row + 1) * arity));
+      EXPECT_EQ((std::begin(nested) + ids[row]).get_parameters(),
+                nested.get_parameters(ids[row]));
+    }
+  }
+}
+
+TEST_F(ParameterSweepBuilder, NodeBasedFactors)
+{
+  std::set<int> s = { 5, 3, 9, 1 };
+  std::list<std::string> l = { "a", "b", "c" };
+  Builder builder(s, i, l);
+  std::vector<std::tuple<int, int, std::string>> expected;
+  for (auto const& ls : l) {
+    for (auto const& is : i) {
+      for (auto const& ss : s) {
+        expected.emplace_back(ss, is, ls);
+      }
+    }
+  }
+
+  for (bool indexed : { true, false }) {
+    builder.set_level_index(indexed);
+    std::vector<std::tuple<int, int, std::string>> results(std::begin(builder),
+                                                           std::end(builder));
+    EXPECT_EQ(expected, results);
+    for (size_t j = 0; j < expected.size(); j += 5) {
+      EXPECT_EQ(expected[j], *(std::begin(builder) + j));
+    }
+  }
+}
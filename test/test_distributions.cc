@@ -1,5 +1,7 @@
 #include <Distributions.hpp>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <random>
 
 #include <gtest/gtest.h>
@@ -57,3 +59,101 @@ TEST(distributions, construction)
                 [&dist_from_tup]() { return dist_from_tup(); });
   EXPECT_EQ(expected, actual) << "from make_dist_from_tuple";
 }
+
+TEST(distributions, philox)
+{
+  // known answers from the Random123 test vectors
+  using counter = Philox4x32::counter_type;
+  using key = Philox4x32::key_type;
+  EXPECT_EQ((counter{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }),
+            Philox4x32::block({ 0, 0, 0, 0 }, { 0, 0 }));
+  EXPECT_EQ((counter{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }),
+            Philox4x32::block({ 0xffffffff, 0xffffffff, 0xffffffff,
+                                0xffffffff },
+                              key{ 0xffffffff, 0xffffffff }));
+  EXPECT_EQ((counter{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }),
+            Philox4x32::block({ 0x243f6a88, 0x85a308d3, 0x13198a2e,
+                                0x03707344 },
+                              key{ 0xa4093822, 0x299f31d0 }));
+
+  Philox4x32 engine(42, 7);
+  std::vector<std::uint32_t> stream(11);
+  std::generate(std::begin(stream), std::end(stream), std::ref(engine));
+  for (size_t skip = 0; skip < stream.size(); ++skip) {
+    Philox4x32 skipped(42, 7);
+    skipped.discard(skip);
+    EXPECT_EQ(stream[skip], skipped()) << skip;
+  }
+  Philox4x32 partial(42, 7);
+  partial();
+  partial.discard(5);
+  EXPECT_EQ(stream[6], partial());
+
+  EXPECT_NE(stream[0], Philox4x32(42, 8)());
+  EXPECT_NE(stream[0], Philox4x32(43, 7)());
+}
+
+TEST(distributions, generate)
+{
+  std::seed_seq seed;
+  std::minstd_rand gen(seed);
+  auto expected_dist = make_dist(gen, std::normal_distribution<float>(10, 3));
+  std::vector<float> expected(1001);
+  std::generate(std::begin(expected), std::end(expected),
+                std::ref(*expected_dist));
+
+  auto batch_dist = make_dist(gen, std::normal_distribution<float>(10, 3));
+  RandomNumberGenerator<float>& batch = *batch_dist;
+  std::vector<float> actual(1001);
+  batch.generate(actual.data(), 1);
+  batch.generate(actual.data() + 1, 1000);
+  EXPECT_EQ(expected, actual);
+
+  Philox4x32 engine(3, 5);
+  std::vector<std::uint32_t> stream(103);
+  std::generate(std::begin(stream), std::end(stream), std::ref(engine));
+  for (size_t offset : { 0, 1, 3, 4, 6 }) {
+    Philox4x32 blocked(3, 5);
+    blocked.discard(offset);
+    std::vector<std::uint32_t> generated(stream.size() - offset);
+    blocked.generate(generated.data(), generated.size() - 2);
+    blocked.generate(generated.data() + generated.size() - 2, 2);
+    EXPECT_TRUE(std::equal(std::begin(generated), std::end(generated),
+                           std::begin(stream) + offset))
+      << offset;
+  }
+}
+
+TEST(distributions, streams)
+{
+  const size_t seed = 12;
+  auto draw = [](RandomNumberGenerator<float>& gen) {
+    std::vector<float> values(100);
+    gen.generate(values.data(), values.size());
+    return values;
+  };
+
+  auto first = make_dist_from_tuple<std::normal_distribution<float>>(
+    std::make_tuple(10, 3), seed, 0);
+  auto again = make_dist_from_tuple<std::normal_distribution<float>>(
+    std::make_tuple(10, 3), seed, 0);
+  auto second = make_dist_from_tuple<std::normal_distribution<float>>(
+    std::make_tuple(10, 3), seed, 1);
+  auto reseeded = make_dist_from_tuple<std::normal_distribution<float>>(
+    std::make_tuple(10, 3), seed + 1, 0);
+
+  auto expected = draw(*first);
+  EXPECT_EQ(expected, draw(*again));
+  EXPECT_NE(expected, draw(*second));
+  EXPECT_NE(expected, draw(*reseeded));
+
+  // streams can be created in any order, e.g. one per worker
+  std::normal_distribution<float> dist(10, 3);
+  auto stream = make_stream(seed, 1);
+  auto second_again = make_dist_from_tuple<std::normal_distribution<float>>(
+    std::make_tuple(10, 3), seed, 1);
+  auto second_values = draw(*second_again);
+  for (size_t i = 0; i < second_values.size(); ++i) {
+    EXPECT_EQ(second_values[i], dist(stream));
+  }
+}
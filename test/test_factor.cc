@@ -130,3 +130,50 @@ TEST_F(FactorTest, ToParameters)
     }
   }
 }
+
+TEST_F(FactorTest, ToParametersArray)
+{
+  static_assert(example_type::parameter_arity == 3);
+  auto it = std::begin(example);
+  for (size_t index = 0; index < example.size(); ++index, ++it) {
+    auto expected = example.get_parameters(index);
+    auto array = it.get_parameter_array();
+    EXPECT_EQ(expected,
+              std::vector<size_t>(std::begin(array), std::end(array)));
+
+    example_type::parameters_type written;
+    EXPECT_EQ(std::end(written),
+              example.write_parameters(index, written.data()));
+    EXPECT_EQ(array, written);
+  }
+}
+
+TEST_F(FactorTest, ManyContainers)
+{
+  std::vector<int> a{ 0, 1, 2 };
+  std::vector<int> b{ 3 };
+  std::set<int> c{ 4, 5 };
+  std::vector<int> d{ 6, 7, 8, 9 };
+  Factor many(a, b, c, d, b, a);
+  std::vector<int> expected{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 3, 0, 1, 2 };
+
+  EXPECT_EQ(std::size(expected), std::size(many));
+  std::vector<int> values(std::begin(many), std::end(many));
+  EXPECT_EQ(expected, values);
+  for (size_t i = 0; i < std::size(expected); ++i) {
+    EXPECT_EQ(expected[i], *(std::begin(many) + i));
+    EXPECT_EQ(i, (std::begin(many) + i) - std::begin(many));
+  }
+  EXPECT_EQ(std::end(many), std::begin(many) + std::size(expected));
+}
+
+TEST_F(FactorTest, WithoutLevelIndex)
+{
+  std::vector<int> indexed(std::begin(example), std::end(example));
+  example.set_level_index(false);
+  std::vector<int> walked(std::begin(example), std::end(example));
+  EXPECT_EQ(indexed, walked);
+  for (size_t i = 0; i < indexed.size(); ++i) {
+    EXPECT_EQ(indexed[i], *(std::begin(example) + i));
+  }
+}
@@ -4,6 +4,7 @@
 #include <Helpers.hpp>
 #include <ParameterSweep.hpp>
 
+#include <atomic>
 #include <functional>
 #include <gtest/gtest.h>
 #include <iterator>
@@ -26,6 +27,7 @@ TEST_F(HelperTest, IteratorPrimitives)
   // perform all the static assertions, avoid unused declaration warning
   TestForwardReadOnly<
     NormalFactor<int>, RangeFactor<int>, RangeFactor<int, Geometric>,
+    LogRangeFactor<int>, LogRangeFactor<double>,
     RandomFactor<int,
                  Distribution<std::mt19937, std::uniform_int_distribution<>>>,
     TransformFactor<std::vector<int>, std::function<int(int)>>,
@@ -161,3 +163,211 @@ TEST_F(HelperTest, getParametersComplex)
     EXPECT_EQ(expected, params);
   }
 }
+
+TEST_F(HelperTest, RandomAccess)
+{
+  auto normal = NormalFactor(10, 2, 3);
+  auto range = RangeFactor(-100, 100, 5);
+  auto float_range = RangeFactor<double>(0.0, 1.0, 11);
+  auto geo_range = RangeFactor<double, Geometric>(1e-6, 1e2, 9);
+
+  auto check = [](auto const& factor) {
+    std::vector<typename std::decay_t<decltype(factor)>::value_type> walked(
+      std::begin(factor), std::end(factor));
+    EXPECT_EQ(std::size(factor), std::size(walked));
+    EXPECT_EQ(std::size(factor),
+              std::distance(std::begin(factor), std::end(factor)));
+    for (size_t k = 0; k < walked.size(); ++k) {
+      auto it = std::begin(factor) + k;
+      EXPECT_EQ(walked[k], *it);
+      EXPECT_EQ(walked[k], std::begin(factor)[k]);
+      EXPECT_EQ(k, it - std::begin(factor));
+      EXPECT_EQ(walked[k], *(std::end(factor) - (walked.size() - k)));
+    }
+    return walked;
+  };
+
+  std::vector<int> expected_normal = { 4, 6, 8, 10, 12, 14, 16 };
+  EXPECT_EQ(expected_normal, check(normal));
+  std::vector<int> expected_range = { -100, -60, -20, 20, 60 };
+  EXPECT_EQ(expected_range, check(range));
+
+  auto float_levels = check(float_range);
+  EXPECT_EQ(0.0, float_levels.front());
+  EXPECT_EQ(1.0, float_levels.back());
+  EXPECT_DOUBLE_EQ(0.3, float_levels[3]);
+
+  auto geo_levels = check(geo_range);
+  EXPECT_EQ(1e-6, geo_levels.front());
+  EXPECT_EQ(1e2, geo_levels.back());
+  EXPECT_NEAR(1e-2, geo_levels[4], 1e-2 * 1e-12);
+}
+
+TEST_F(HelperTest, LogRange)
+{
+  auto powers = LogRangeFactor<int>(1, 1 << 30, 31);
+  ASSERT_EQ(31, std::size(powers));
+  for (size_t k = 0; k < std::size(powers); ++k) {
+    EXPECT_EQ(1 << k, powers[k]);
+    EXPECT_EQ(1 << k, std::begin(powers)[k]);
+  }
+
+  // rounding collapses the small levels, size reports what is left
+  auto narrow = LogRangeFactor<int>(1, 10, 20);
+  std::vector<int> narrow_levels(std::begin(narrow), std::end(narrow));
+  std::vector<int> expected_narrow = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+  EXPECT_EQ(expected_narrow, narrow_levels);
+  EXPECT_EQ(std::size(expected_narrow), std::size(narrow));
+
+  auto decades = LogRangeFactor<double>(1e-6, 1e2, 9);
+  ASSERT_EQ(9, std::size(decades));
+  EXPECT_EQ(1e-6, decades.get_min());
+  EXPECT_EQ(1e2, decades.get_max());
+  for (size_t k = 0; k < std::size(decades); ++k) {
+    EXPECT_NEAR(std::pow(10.0, static_cast<double>(k) - 6.0), decades[k],
+                decades[k] * 1e-12);
+  }
+}
+
+TEST_F(HelperTest, MemoizedTransform)
+{
+  std::atomic<size_t> calls{ 0 };
+  auto trans = TransformFactor(RangeFactor(0, 9, 10), [&calls](int i) {
+    ++calls;
+    return std::to_string(i);
+  });
+  trans.set_memoize(true);
+
+  // copies held by the builder share the cache
+  auto builder = Builder(trans, NormalFactor(0, 1, 2));
+  size_t visited = 0;
+  for (auto const& value : builder) {
+    EXPECT_EQ(1, std::get<0>(value).size());
+    ++visited;
+  }
+  EXPECT_EQ(50, visited);
+  EXPECT_EQ(10, calls);
+
+  std::vector<std::string> levels(std::begin(trans), std::end(trans));
+  EXPECT_EQ("7", levels[7]);
+  EXPECT_EQ("3", std::begin(trans)[3]);
+  EXPECT_EQ(10, calls);
+
+  // only the first levels up to the limit are kept
+  calls = 0;
+  trans.set_memoize(true, 2);
+  for (int pass = 0; pass < 3; ++pass) {
+    std::vector<std::string> again(std::begin(trans), std::end(trans));
+    EXPECT_EQ(levels, again);
+  }
+  EXPECT_EQ(2 + 3 * 8, calls);
+
+  calls = 0;
+  trans.set_memoize(true);
+  parallel_for_each(Builder(trans, NormalFactor(0, 1, 2)),
+                    [](auto const&) {}, ParallelOptions{ 4, 1 });
+  EXPECT_EQ(10, calls);
+
+  calls = 0;
+  trans.set_memoize(false);
+  std::vector<std::string> unmemoized(std::begin(trans), std::end(trans));
+  EXPECT_EQ(levels, unmemoized);
+  EXPECT_EQ(10, calls);
+}
+
+TEST_F(HelperTest, FusedTransform)
+{
+  auto range = RangeFactor(0, 9, 10);
+  auto scaled = TransformFactor(range, [](int i) { return i * 1000; });
+  auto shifted = compose(scaled, [](int i) { return i + 7; });
+  auto converted =
+    compose(shifted, [](int i) { return static_cast<double>(i) / 2; });
+
+  // each layer is folded into the function over the original range
+  using fused_container = typename decltype(converted)::container_type;
+  static_assert(std::is_same<decltype(range), fused_container>::value,
+                "transforms of transforms should be fused");
+
+  std::vector<double> expected;
+  for (int i = 0; i < 10; ++i) {
+    expected.push_back(static_cast<double>(i * 1000 + 7) / 2);
+  }
+  std::vector<double> walked(std::begin(converted), std::end(converted));
+  EXPECT_EQ(expected, walked);
+  EXPECT_EQ(expected, converted.evaluate_all());
+  EXPECT_EQ(expected[4], std::begin(converted)[4]);
+  EXPECT_EQ(std::vector<size_t>{ 6 }, converted.get_parameters(6));
+
+  converted.set_bulk(true);
+  std::vector<double> bulk(std::begin(converted), std::end(converted));
+  EXPECT_EQ(expected, bulk);
+  EXPECT_EQ(expected[8], *(std::begin(converted) + 8));
+}
+
+TEST_F(HelperTest, NestedTransformKeepsMemoizedResults)
+{
+  std::atomic<size_t> calls{ 0 };
+  auto inner = TransformFactor(RangeFactor(0, 2, 3), [&calls](int i) {
+    ++calls;
+    return std::to_string(i);
+  });
+  inner.set_memoize(true);
+  auto outer =
+    TransformFactor(inner, [](std::string const& s) { return s + "!"; });
+
+  // wrapping a factor nests it rather than fusing away its cache
+  static_assert(std::is_same<decltype(inner),
+                             typename decltype(outer)::container_type>::value,
+                "wrapping a transform should not fuse it");
+  auto builder = Builder(outer, NormalFactor(0, 1, 16));
+  for (auto const& value : builder) {
+    EXPECT_EQ(2, std::get<0>(value).size());
+  }
+  EXPECT_EQ(3, calls);
+}
+
+TEST_F(HelperTest, CounterRandom)
+{
+  auto random =
+    CounterRandomFactor(std::uniform_int_distribution<>(-100, 100), 1000, 42);
+  std::vector<int> walked(std::begin(random), std::end(random));
+  ASSERT_EQ(1000, walked.size());
+  EXPECT_TRUE(std::any_of(std::begin(walked), std::end(walked),
+                          [&](int i) { return i != walked.front(); }));
+
+  // every copy, and every starting point, agrees on each level
+  auto copy = CounterRandomFactor(std::uniform_int_distribution<>(-100, 100),
+                                  1000, 42);
+  for (size_t k = 0; k < walked.size(); k += 37) {
+    EXPECT_EQ(walked[k], *(std::begin(copy) + k));
+    EXPECT_EQ(walked[k], random.get_level(k));
+  }
+
+  // levels are computed on demand, so huge factors cost no memory
+  auto huge = CounterRandomFactor(std::normal_distribution<>(0, 1),
+                                  size_t{ 1 } << 40, 7);
+  EXPECT_EQ(size_t{ 1 } << 40, std::size(huge));
+  EXPECT_EQ(huge.get_level(999999999999), std::begin(huge)[999999999999]);
+
+  auto reseeded = CounterRandomFactor(
+    std::uniform_int_distribution<>(-100, 100), 1000, 43);
+  std::vector<int> other(std::begin(reseeded), std::end(reseeded));
+  EXPECT_NE(walked, other);
+}
+
+TEST_F(HelperTest, RandomBatch)
+{
+  std::seed_seq seed;
+  std::mt19937 eng(seed);
+  auto dist = Distribution(eng, std::uniform_int_distribution<>(-100, 100));
+
+  std::uniform_int_distribution<> expected_gen(-100, 100);
+  std::mt19937 expected_eng(seed);
+  std::vector<int> expected(100);
+  std::generate(std::begin(expected), std::end(expected),
+                [&] { return expected_gen(expected_eng); });
+
+  auto random = RandomFactor(dist, 100);
+  std::vector<int> values(std::begin(random), std::end(random));
+  EXPECT_EQ(expected, values);
+}
@@ -0,0 +1,156 @@
+#include <Parallel.hpp>
+#include <ParameterSweep.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace ParameterSweep;
+
+class ParallelTest : public ::testing::Test
+{
+public:
+  virtual void SetUp() { example.set_replicants(3); }
+
+  std::vector<int> i = { 1, 2, 3, 4, 5, 6, 7 };
+  std::vector<float> f = { 1., 2., 3., 4., 5. };
+  Builder<std::vector<int>, std::vector<float>> example = { i, f };
+  using iterator = decltype(example)::iterator;
+};
+
+TEST_F(ParallelTest, VisitsEveryPointOnce)
+{
+  for (size_t threads : { 1, 2, 4, 7 }) {
+    for (size_t chunk_size : { 1, 4, 1000 }) {
+      std::vector<std::atomic<int>> visits(example.size());
+      parallel_for_each_iterator(
+        example,
+        [&visits, this](iterator const& it) {
+          EXPECT_EQ(*(std::begin(example) + it.get_id()), *it);
+          visits[it.get_id()]++;
+        },
+        ParallelOptions{ threads, chunk_size });
+      for (size_t id = 0; id < visits.size(); ++id) {
+        EXPECT_EQ(1, visits[id]) << "id " << id << " with " << threads
+                                 << " threads";
+      }
+    }
+  }
+}
+
+TEST_F(ParallelTest, CallsWithValues)
+{
+  std::atomic<int> sum{ 0 };
+  parallel_for_each(example,
+                    [&sum](std::tuple<int, float> const& value) {
+                      sum += std::get<0>(value);
+                    },
+                    ParallelOptions{ 4, 2 });
+  EXPECT_EQ((1 + 2 + 3 + 4 + 5 + 6 + 7) * 5 * 3, sum);
+}
+
+TEST_F(ParallelTest, CallsGenericLambdasWithIterators)
+{
+  std::atomic<size_t> ids{ 0 };
+  parallel_for_each_iterator(example,
+                             [&ids](auto const& it) { ids += it.get_id(); },
+                             ParallelOptions{ 4, 3 });
+  EXPECT_EQ(example.size() * (example.size() - 1) / 2, ids);
+}
+
+namespace {
+// a sweep of ids that counts how often its iterators seek instead of step
+struct SeekCountingSweep
+{
+  struct iterator
+  {
+    using difference_type = std::ptrdiff_t;
+    using value_type = size_t;
+    using reference = size_t;
+    using pointer = void;
+    using iterator_category = std::random_access_iterator_tag;
+
+    size_t operator*() const { return id; }
+    iterator& operator++()
+    {
+      ++id;
+      return *this;
+    }
+    iterator& operator+=(difference_type n)
+    {
+      ++*seeks;
+      id += n;
+      return *this;
+    }
+
+    size_t id;
+    std::atomic<size_t>* seeks;
+  };
+
+  iterator begin() const { return { 0, &seeks }; }
+  size_t size() const { return points; }
+
+  size_t points;
+  mutable std::atomic<size_t> seeks{ 0 };
+};
+} // namespace
+
+TEST_F(ParallelTest, StepsBetweenAdjacentChunks)
+{
+  for (size_t chunk_size : { 1, 3 }) {
+    SeekCountingSweep sweep{ 100 };
+    std::vector<std::atomic<int>> visits(sweep.size());
+    parallel_for_each(sweep, [&visits](size_t id) { visits[id]++; },
+                      ParallelOptions{ 1, chunk_size });
+    EXPECT_EQ(0, sweep.seeks);
+    for (auto const& count : visits) {
+      EXPECT_EQ(1, count);
+    }
+  }
+}
+
+TEST_F(ParallelTest, StealsUnevenWork)
+{
+  // all of the slow points are at the front of the first worker's share
+  size_t const threads = 4;
+  size_t const first_share = example.size() / threads;
+  std::vector<std::thread::id> workers(example.size());
+  parallel_for_each_iterator(
+    example,
+    [&workers](iterator const& it) {
+      if (it.get_id() < 10) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      workers[it.get_id()] = std::this_thread::get_id();
+    },
+    ParallelOptions{ threads, 1 });
+
+  std::set<std::thread::id> first_share_workers(
+    std::begin(workers), std::begin(workers) + first_share);
+  EXPECT_LT(1, first_share_workers.size());
+}
+
+TEST_F(ParallelTest, EmptySweep)
+{
+  Builder<> empty{};
+  size_t calls = 0;
+  parallel_for_each(empty, [&calls](auto const&) { ++calls; });
+  EXPECT_EQ(0, calls);
+}
+
+TEST_F(ParallelTest, PropagatesExceptions)
+{
+  EXPECT_THROW(parallel_for_each_iterator(example,
+                                          [](iterator const& it) {
+                                            if (it.get_id() == 17) {
+                                              throw std::runtime_error(
+                                                "failed");
+                                            }
+                                          },
+                                          ParallelOptions{ 4, 1 }),
+               std::runtime_error);
+}
@@ -0,0 +1,78 @@
+#include <Permutation.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <numeric>
+#include <vector>
+
+namespace {
+template <class Permutation>
+void
+expect_bijection(Permutation const& permutation)
+{
+  std::vector<bool> seen(permutation.size(), false);
+  for (size_t i = 0; i < permutation.size(); ++i) {
+    size_t mapped = permutation(i);
+    ASSERT_LT(mapped, permutation.size());
+    EXPECT_FALSE(seen[mapped]) << mapped << " visited twice";
+    seen[mapped] = true;
+    EXPECT_EQ(i, permutation.inverse(mapped));
+  }
+}
+} // namespace
+
+TEST(permutation, FeistelAnySize)
+{
+  for (size_t size : { 1, 2, 3, 7, 100, 223, 1000, 4096, 12345 }) {
+    expect_bijection(FeistelPermutation(size, 42));
+  }
+}
+
+TEST(permutation, FeistelSeeds)
+{
+  FeistelPermutation first(1000, 1), again(1000, 1), second(1000, 2);
+  size_t fixed_points = 0, differ = 0;
+  for (size_t i = 0; i < 1000; ++i) {
+    EXPECT_EQ(first(i), again(i));
+    differ += first(i) != second(i);
+    fixed_points += first(i) == i;
+  }
+  EXPECT_GT(differ, 900);
+  EXPECT_LT(fixed_points, 10);
+}
+
+TEST(permutation, FeistelMixes)
+{
+  // neighbouring indices should land far apart, not at a fixed stride
+  const size_t size = 1 << 20;
+  FeistelPermutation permutation(size, 7);
+  std::vector<std::int64_t> steps;
+  for (size_t i = 0; i + 1 < 1000; ++i) {
+    steps.push_back(static_cast<std::int64_t>(permutation(i + 1)) -
+                    static_cast<std::int64_t>(permutation(i)));
+  }
+  std::sort(std::begin(steps), std::end(steps));
+  EXPECT_GT(std::unique(std::begin(steps), std::end(steps)) - std::begin(steps),
+            990);
+
+  // first positions spread evenly over the halves of the range
+  size_t low = 0;
+  for (size_t i = 0; i < 10000; ++i) {
+    low += permutation(i) < size / 2;
+  }
+  EXPECT_NEAR(5000, low, 250);
+
+  FeistelPermutation huge(size_t{ 1 } << 40, 7);
+  size_t i = (size_t{ 1 } << 39) + 12345;
+  EXPECT_EQ(i, huge.inverse(huge(i)));
+}
+
+TEST(permutation, Affine)
+{
+  AffinePermutation<223, 331> permutation(100);
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_EQ((223 + 331 * i) % 100, permutation(i));
+  }
+  expect_bijection(permutation);
+}
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <iterator>
 
+#include "Builder.hpp"
 #include "RandomOrder.hpp"
 
 class RandomOrderTest: public ::testing::Test
@@ -41,3 +42,77 @@ TEST_F(RandomOrderTest, IdsAreAccending) {
 		EXPECT_EQ(i, it.get_id());
 	}
 }
+
+TEST_F(RandomOrderTest, ShuffleAnySize) {
+	// 223 is not co-prime with 446, which RandomOrder<T, 223, 331> rejects
+	std::vector<int> values(446);
+	std::iota(values.begin(), values.end(), 0);
+
+	ShuffleOrder<decltype(values)> shuffled(values, 12);
+	std::vector<int> order(std::begin(shuffled), std::end(shuffled));
+	std::vector<int> sorted = order;
+	std::sort(sorted.begin(), sorted.end());
+
+	EXPECT_EQ(values, sorted);
+	EXPECT_NE(values, order);
+
+	ShuffleOrder<decltype(values)> reseeded(values, 13);
+	std::vector<int> other(std::begin(reseeded), std::end(reseeded));
+	EXPECT_NE(order, other);
+
+	ShuffleOrder<decltype(values)> again(values, 12);
+	EXPECT_TRUE(std::equal(std::begin(again), std::end(again), order.begin()));
+}
+
+TEST_F(RandomOrderTest, RandomAccess) {
+	ShuffleOrder<decltype(container)> random(container, 7);
+	std::vector<int> order(std::begin(random), std::end(random));
+
+	auto it = std::end(random);
+	for (size_t i = order.size(); i-- > 0;) {
+		--it;
+		EXPECT_EQ(order[i], *it);
+		EXPECT_EQ(i, it.get_id());
+	}
+	EXPECT_EQ(order[42], *(std::begin(random) + 42));
+	EXPECT_EQ(order[42], *(std::end(random) - 58));
+	EXPECT_EQ(order[42], std::begin(random)[42]);
+	EXPECT_EQ(100, std::end(random) - std::begin(random));
+}
+
+TEST_F(RandomOrderTest, PositionOf) {
+	ShuffleOrder<decltype(container)> random(container, 7);
+	for (size_t position = 0; position < std::size(random); ++position) {
+		size_t id = random.id_at(position);
+		EXPECT_EQ(container[id], *random.at(position));
+		EXPECT_EQ(id, random.at(position).get_mapped_id());
+		EXPECT_EQ(position, random.position_of(id));
+	}
+
+	RandomOrder<decltype(container), 223, 331> affine(container);
+	for (size_t id = 0; id < std::size(affine); ++id) {
+		EXPECT_EQ(container[id], *affine.at(affine.position_of(id)));
+	}
+}
+
+TEST_F(RandomOrderTest, Resume) {
+	ShuffleOrder<decltype(container)> random(container, 7);
+	std::vector<int> order(std::begin(random), std::end(random));
+
+	//restart after the point with id 10 without replaying the points before
+	std::vector<int> resumed(random.at(random.position_of(10) + 1), std::end(random));
+	std::vector<int> expected(order.begin() + random.position_of(10) + 1, order.end());
+	EXPECT_EQ(expected, resumed);
+}
+
+TEST_F(RandomOrderTest, GetParameters) {
+	ParameterSweep::Builder builder(std::vector<int>{1, 2, 3}, std::vector<int>{4, 5});
+	ShuffleOrder<decltype(builder)> random(builder, 3);
+	static_assert(decltype(random)::parameter_arity == 2, "parameters of the builder");
+
+	auto it = std::begin(random);
+	for (size_t i = 0; i < std::size(random); ++i, ++it) {
+		EXPECT_EQ(builder.get_parameters(random.id_at(i)), random.get_parameters(i));
+		EXPECT_EQ(builder.get_parameters(random.id_at(i)), it.get_parameters());
+	}
+}
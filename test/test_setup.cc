@@ -0,0 +1,149 @@
+#include <ParameterSweep.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace ParameterSweep;
+
+class SetupTest : public ::testing::Test
+{
+public:
+  virtual void SetUp()
+  {
+    dataset_loads = 0;
+    kernel_builds = 0;
+  }
+
+  std::vector<std::string> datasets = { "small", "medium", "large" };
+  std::vector<int> kernels = { 1, 2, 4, 8 };
+  std::vector<float> tolerances = { .1f, .01f };
+  std::atomic<size_t> dataset_loads;
+  std::atomic<size_t> kernel_builds;
+
+  auto load_dataset()
+  {
+    return [this](std::string const& name) {
+      ++dataset_loads;
+      return std::vector<char>(name.size(), name.front());
+    };
+  }
+  auto build_kernel()
+  {
+    return [this](int width) {
+      ++kernel_builds;
+      return "kernel" + std::to_string(width);
+    };
+  }
+};
+
+TEST_F(SetupTest, RunsOnlyWhenChanged)
+{
+  Builder builder(kernels, tolerances, datasets);
+  auto sweep = with_setup(builder, build_kernel(), NoSetup{}, load_dataset());
+  EXPECT_EQ(builder.size(), sweep.size());
+
+  size_t count = 0;
+  for (auto it = std::begin(sweep); it != std::end(sweep); ++it, ++count) {
+    auto const& [kernel, tolerance, dataset] = *it;
+    EXPECT_EQ("kernel" + std::to_string(kernel), it.get_product<0>());
+    EXPECT_EQ(dataset.size(), it.get_product<2>().size());
+    EXPECT_EQ(dataset.front(), it.get_product<2>().front());
+    (void)tolerance;
+  }
+  EXPECT_EQ(builder.size(), count);
+  // the dataset is the slowest varying factor, so it is loaded once per level
+  EXPECT_EQ(3, dataset_loads);
+  // the kernel changes at every point and only the last kernel is kept
+  EXPECT_EQ(builder.size(), kernel_builds);
+}
+
+TEST_F(SetupTest, CachesRecentProducts)
+{
+  Builder builder(kernels, tolerances, datasets);
+  auto sweep = with_setup(builder, build_kernel(), NoSetup{}, load_dataset());
+  sweep.set_cache_size(kernels.size());
+  for (auto it = std::begin(sweep); it != std::end(sweep); ++it) {
+    EXPECT_EQ("kernel" + std::to_string(std::get<0>(*it)),
+              it.get_product<0>());
+  }
+  EXPECT_EQ(kernels.size(), kernel_builds);
+  EXPECT_EQ(3, dataset_loads);
+
+  // seeking reuses cached products and only loads what is missing
+  auto it = std::begin(sweep) + 5;
+  EXPECT_EQ(kernels.size(), kernel_builds);
+  it += 11;
+  EXPECT_EQ("large", std::get<2>(*it));
+  EXPECT_EQ(std::vector<char>(5, 'l'), it.get_product<2>());
+  EXPECT_EQ(3, dataset_loads);
+  it -= 16;
+  EXPECT_EQ(std::vector<char>(5, 's'), it.get_product<2>());
+  EXPECT_EQ(3, dataset_loads) << "every dataset is still cached";
+}
+
+TEST_F(SetupTest, FollowsChangeCost)
+{
+  Builder builder(datasets, kernels);
+  builder.set_factor_change_cost({ 100., 1. });
+  auto sweep = with_setup(builder, load_dataset(), build_kernel());
+  for (auto it = std::begin(sweep); it != std::end(sweep); ++it) {
+    EXPECT_EQ(std::get<0>(*it).front(), it.get_product<0>().front());
+  }
+  EXPECT_EQ(3, dataset_loads);
+  EXPECT_EQ(builder.size(), kernel_builds);
+}
+
+TEST_F(SetupTest, Parallel)
+{
+  Builder builder(kernels, tolerances, datasets);
+  auto sweep = with_setup(builder, build_kernel(), NoSetup{}, load_dataset());
+  sweep.set_cache_size(kernels.size());
+  using iterator = decltype(sweep)::iterator;
+  std::atomic<size_t> visited{ 0 };
+  parallel_for_each_iterator(
+    sweep,
+    [&visited](iterator const& it) {
+      EXPECT_EQ(std::get<2>(*it).front(), it.get_product<2>().front());
+      ++visited;
+    },
+    ParallelOptions{ 4, 2 });
+  EXPECT_EQ(builder.size(), visited);
+  EXPECT_LE(kernel_builds, builder.size());
+}
+
+TEST_F(SetupTest, SetupRunsUnlocked)
+{
+  detail::ProductCache<int> cache;
+  std::promise<void> started, other_loaded;
+  auto other_loaded_future = other_loaded.get_future();
+  auto slow_setup = [&](int level) {
+    started.set_value();
+    // another level of the same factor can be loaded meanwhile
+    EXPECT_EQ(std::future_status::ready,
+              other_loaded_future.wait_for(std::chrono::seconds(10)));
+    return level;
+  };
+  std::thread slow(
+    [&] { EXPECT_EQ(0, *cache.get(0, 2, slow_setup, 0)); });
+  started.get_future().wait();
+  EXPECT_EQ(1, *cache.get(1, 2, [](int level) { return level; }, 1));
+  other_loaded.set_value();
+  slow.join();
+
+  // hits do not run setup again
+  EXPECT_EQ(0, *cache.get(0, 2, [](int) -> int { throw 1; }, 0));
+}
+
+TEST_F(SetupTest, RetriesFailedSetup)
+{
+  detail::ProductCache<int> cache;
+  auto failing = [](int) -> int { throw std::runtime_error("failed"); };
+  EXPECT_THROW(cache.get(0, 1, failing, 0), std::runtime_error);
+  EXPECT_EQ(3, *cache.get(0, 1, [](int level) { return level + 3; }, 0));
+}